@@ -1,16 +1,57 @@
 import ChessAmateur from './module.js';
 import Chessboard from './chessboard.js';
+import Engine, {TimeSlicedEngine} from './engine.js';
 
 ChessAmateur.onRuntimeInitialized = () => {
     const logger = new ChessLogger(document.getElementById('moves'));
 
+    // Searches run in a worker with their own copy of the game, so the page keeps responding while they think.
+    // Without workers, the page's module searches in slices between frames instead. A module built before those
+    // bindings existed (no getMoveHistory or playMove) can only search synchronously with computerMove, and one
+    // older still can't search at all, which leaves both sides to the player
+    const hasSearchBindings = typeof ChessAmateur.getMoveHistory === 'function' &&
+        typeof ChessAmateur.playMove === 'function';
+    const pageSearcher = () => typeof ChessAmateur.searchStep === 'function' ? new TimeSlicedEngine(ChessAmateur)
+        : undefined;
+    let searcher = !hasSearchBindings ? undefined : typeof Worker === 'function' ? new Engine() : pageSearcher();
+
+    // Resolves with the move made, like the searchers, but blocks the page while it thinks
+    const synchronousMove = (timeMs) => new Promise((resolve) => {
+        // Let the player's move draw before the engine starts thinking
+        setTimeout(() => {
+            const move = ChessAmateur.computerMove(timeMs);
+            resolve(move >= 0 ? {from: move % 64, to: Math.floor(move / 64)} : null);
+        }, 0);
+    });
+
+    const computerMove = (timeMs) => {
+        if (!searcher) {
+            return synchronousMove(timeMs);
+        }
+
+        searcher.setPosition(ChessAmateur.getMoveHistory());
+        return searcher.think({timeMs: timeMs})
+            .then((move) => move && ChessAmateur.playMove(move.packed) ? move : null, (error) => {
+                // The worker couldn't start, eg engine-module.js wasn't built: search on the page from now on
+                console.log(error.message);
+                searcher = pageSearcher();
+                return computerMove(timeMs);
+            });
+    };
+
     let engine = {
-        newGame: ChessAmateur.newGame,
+        newGame: () => {
+            if (searcher) {
+                searcher.newGame();
+            }
+            ChessAmateur.newGame();
+        },
         getPieces: ChessAmateur.getPieces,
         tryMove: ChessAmateur.tryMove,
         canMove: ChessAmateur.canMove,
         promote: ChessAmateur.promote,
         whiteToMove: ChessAmateur.whiteToMove,
+        computerMove: hasSearchBindings || ChessAmateur.computerMove ? computerMove : undefined,
         PromotionChoices: ChessAmateur.PromotionChoices,
     };
 
@@ -0,0 +1,499 @@
+#include <chrono>
+#include <functional>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+#include "src/GameState.h"
+#include "src/Nnue.h"
+#include "src/Perft.h"
+#include "src/Search.h"
+#include "src/bitboard.h"
+
+// Native micro-benchmarks for the engine's building blocks
+// Usage: bench [name...] (runs every benchmark if none are named)
+
+using namespace CA3;
+using std::string;
+using std::vector;
+
+const vector<string> positions{
+        "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1",
+        "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",
+        "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1",
+        "r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1",
+        "rnbq1k1r/pp1Pbppp/2p5/8/2B5/8/PPP1NnPP/RNBQK2R w KQ - 1 8",
+        "r4rk1/1pp1qppp/p1np1n2/2b1p1B1/2B1P1b1/P1NP1N2/1PP1QPPP/R4RK1 w - - 0 10"
+};
+
+// Times calls to f, which performs 'calls' operations per run, and prints nanoseconds per operation.
+// f returns a checksum so the work can't be optimized away
+double timeIt(const string& label, size_t calls, const std::function<uint64_t()>& f) {
+    const int runs = 200;
+    uint64_t checksum = 0;
+
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < runs; i++) {
+        checksum += f();
+    }
+    std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+
+    double ns = elapsed.count() / ((double) runs * calls);
+    std::cout << "  " << label << ": " << ns << " ns (checksum " << checksum % 1000 << ")\n";
+    return ns;
+}
+
+// Slider attacks: walking dirPtr over the mailbox (as generateMoves used to), classical rays, and magics
+void benchSliders() {
+    struct Slider {
+        GameState* gs;
+        Square square;
+        Direction first, last;
+    };
+
+    vector<GameState> states;
+    for (const string& fen : positions) {
+        states.push_back(parseFen(fen));
+    }
+
+    vector<Slider> sliders;
+    for (GameState& gs : states) {
+        for (Square s = 0; s < 64; s++) {
+            Piece p = gs[s];
+            if (isRook(p) || isQueen(p)) {
+                sliders.push_back({&gs, s, RANKFILE_START, RANKFILE_END});
+            }
+            if (isBishop(p) || isQueen(p)) {
+                sliders.push_back({&gs, s, DIAGONAL_START, DIAGONAL_END});
+            }
+        }
+    }
+
+    std::cout << "sliders: attack sets for " << sliders.size() << " rook and bishop rays\n";
+
+    double walk = timeIt("dirPtr walk", sliders.size(), [&]() {
+        uint64_t sum = 0;
+        for (const Slider& slider : sliders) {
+            Bitboard attacks = EMPTY_BOARD;
+            for (Direction d = slider.first; d <= slider.last; d++) {
+                int inc = dirIncrement(d);
+                Square to;
+                for (Square const* p = dirPtr(d, slider.square); (to = *p) != INVALID_SQUARE; p += inc) {
+                    attacks |= squareBit(to);
+                    if ((*slider.gs)[to] != NO_PIECE) {
+                        break;
+                    }
+                }
+            }
+            sum += attacks;
+        }
+        return sum;
+    });
+
+    double rays = timeIt("classical rays", sliders.size(), [&]() {
+        uint64_t sum = 0;
+        for (const Slider& slider : sliders) {
+            Bitboard occupied = slider.gs->occupied();
+            Bitboard attacks = EMPTY_BOARD;
+            for (Direction d = slider.first; d <= slider.last; d++) {
+                attacks |= rayAttacks(d, slider.square, occupied);
+            }
+            sum += attacks;
+        }
+        return sum;
+    });
+
+    double magic = timeIt("magic lookup", sliders.size(), [&]() {
+        uint64_t sum = 0;
+        for (const Slider& slider : sliders) {
+            Bitboard occupied = slider.gs->occupied();
+            sum += slider.first == RANKFILE_START ? rookAttacks(slider.square, occupied)
+                                                  : bishopAttacks(slider.square, occupied);
+        }
+        return sum;
+    });
+
+    std::cout << "  magic speedup: " << walk / magic << "x over dirPtr walk, " << rays / magic
+              << "x over classical rays\n";
+}
+
+// Whether a piece of color 'by' attacks s, found the way isThreatenedBy did before bitboards: walking the eight rays
+// out from s over the mailbox to the first piece, then the knight and king squares around s
+bool rayWalkAttacked(const GameState& gs, Square s, Color by) {
+    for (Direction d = ALLDIR_START; d <= ALLDIR_END; d++) {
+        bool straight = d <= RANKFILE_END;
+        int inc = dirIncrement(d);
+        Square to;
+        for (Square const* p = dirPtr(d, s); (to = *p) != INVALID_SQUARE; p += inc) {
+            Piece piece = gs[to];
+            if (piece == NO_PIECE) {
+                continue;
+            }
+            if (pieceColor(piece) == by && (isQueen(piece) || (straight ? isRook(piece) : isBishop(piece)))) {
+                return true;
+            }
+            break;
+        }
+    }
+
+    Square to;
+    for (Square const* p = knightPtr(s); (to = *p) != INVALID_SQUARE; p++) {
+        if (gs[to] == (by == WHITE ? WHITE_KNIGHT : BLACK_KNIGHT)) {
+            return true;
+        }
+    }
+    for (Square const* p = kingPtr(s); (to = *p) != INVALID_SQUARE; p++) {
+        if (gs[to] == (by == WHITE ? WHITE_KING : BLACK_KING)) {
+            return true;
+        }
+    }
+    return pawnAttacks(s, enemyColor(by)) & gs.pieceBoard(PIECE_PAWN, by);
+}
+
+// "Is this square attacked" for every square and color of every position: walking rays, looking up the attackers
+// with magics, and building the attack maps once per position then looking each square up. The last shows how many
+// squares a caller has to ask about before building the map pays for itself
+void benchAttacks() {
+    vector<GameState> states;
+    for (const string& fen : positions) {
+        states.push_back(parseFen(fen));
+    }
+    const size_t queries = states.size() * 2 * 64;
+
+    std::cout << "attacks: " << queries << " attacked square queries\n";
+
+    double walk = timeIt("ray walk", queries, [&]() {
+        uint64_t sum = 0;
+        for (const GameState& gs : states) {
+            for (Color c : {BLACK, WHITE}) {
+                for (Square s = 0; s < 64; s++) {
+                    sum += rayWalkAttacked(gs, s, c);
+                }
+            }
+        }
+        return sum;
+    });
+
+    double attackers = timeIt("attackersTo", queries, [&]() {
+        uint64_t sum = 0;
+        for (const GameState& gs : states) {
+            for (Color c : {BLACK, WHITE}) {
+                for (Square s = 0; s < 64; s++) {
+                    sum += (gs.attackersTo(s, gs.occupied()) & gs.colorBoard(c)) != EMPTY_BOARD;
+                }
+            }
+        }
+        return sum;
+    });
+
+    // Setting a piece back on its square clears the cached maps without changing the position
+    double map = timeIt("attack map, built per position", queries, [&]() {
+        uint64_t sum = 0;
+        for (GameState& gs : states) {
+            gs.setPiece(0, gs[0]);
+            for (Color c : {BLACK, WHITE}) {
+                Bitboard attacked = gs.attackedBy(c);
+                for (Square s = 0; s < 64; s++) {
+                    sum += contains(attacked, s);
+                }
+            }
+        }
+        return sum;
+    });
+
+    double build = timeIt("attack map build", states.size() * 2, [&]() {
+        uint64_t sum = 0;
+        for (GameState& gs : states) {
+            gs.setPiece(0, gs[0]);
+            sum += gs.attackedBy(BLACK) + gs.attackedBy(WHITE);
+        }
+        return sum;
+    });
+
+    std::cout << "  speedup over ray walk: " << walk / attackers << "x for attackersTo, " << walk / map
+              << "x for the attack map. A map pays for itself after " << build / attackers << " queries\n";
+}
+
+// The move generator and makeMove/unmakeMove on their own, for each side to act. Both are specialized for the
+// color to act when compiling, so there's no separate runtime branching version to compare against: run this
+// before and after a change to them instead
+void benchMoves() {
+    vector<GameState> states;
+    for (const string& fen : positions) {
+        for (Color c : {WHITE, BLACK}) {
+            GameState gs = parseFen(fen);
+            if (!gs.isThreatenedBy(gs.getKingLocation(c == WHITE ? BLACK : WHITE), c)) {
+                gs.setToAct(c);
+                gs.setEnPassantSquare(INVALID_SQUARE);
+                states.push_back(gs);
+            }
+        }
+    }
+
+    vector<vector<Move>> legal;
+    size_t moveCount = 0;
+    for (GameState& gs : states) {
+        legal.push_back(gs.generateMoves());
+        moveCount += legal.back().size();
+    }
+
+    // Every position up to two moves away that is check, for the evasion generator
+    vector<GameState> checked;
+    for (size_t i = 0; i < states.size(); i++) {
+        GameState& gs = states[i];
+        for (Move m : legal[i]) {
+            gs.makeMove(m);
+            for (Move reply : gs.generateMoves()) {
+                gs.makeMove(reply);
+                if (gs.currentPlayerInCheck()) {
+                    checked.push_back(gs);
+                }
+                gs.unmakeMove();
+            }
+            gs.unmakeMove();
+        }
+    }
+
+    std::cout << "moves: " << states.size() << " positions with both sides to act, " << moveCount << " moves, "
+              << checked.size() << " positions in check\n";
+
+    MoveList moves;
+    timeIt("generateMoves", states.size(), [&]() {
+        uint64_t sum = 0;
+        for (GameState& gs : states) {
+            gs.generateMoves(moves);
+            sum += moves.size();
+        }
+        return sum;
+    });
+
+    timeIt("generateMoves in check", checked.size(), [&]() {
+        uint64_t sum = 0;
+        for (GameState& gs : checked) {
+            gs.generateMoves(moves);
+            sum += moves.size();
+        }
+        return sum;
+    });
+
+    timeIt("generate captures", states.size(), [&]() {
+        uint64_t sum = 0;
+        for (GameState& gs : states) {
+            gs.generateCaptures(moves);
+            sum += moves.size();
+        }
+        return sum;
+    });
+
+    timeIt("makeMove and unmakeMove", moveCount, [&]() {
+        uint64_t sum = 0;
+        for (size_t i = 0; i < states.size(); i++) {
+            GameState& gs = states[i];
+            for (Move m : legal[i]) {
+                gs.makeMove(m);
+                sum += gs.getKey();
+                gs.unmakeMove();
+            }
+        }
+        return sum;
+    });
+}
+
+// Totals over fixed depth searches of every position
+struct SearchTotals {
+    uint64_t nodes, cutNodes, firstMoveCutoffs, movesBeforeCutoff;
+    double ms;
+};
+
+SearchTotals searchPositions(const SearchOptions& options, int depth) {
+    TranspositionTable tt{16};
+    Search search{tt};
+    search.options = options;
+    SearchLimits limits;
+    limits.depth = depth;
+
+    SearchTotals totals{};
+    auto start = std::chrono::steady_clock::now();
+    for (const string& fen : positions) {
+        tt.clear();
+        search.clear();
+        totals.nodes += search.think(parseFen(fen), limits).nodes;
+
+        const MoveOrdering::Stats& stats = search.orderingStats();
+        totals.cutNodes += stats.cutNodes;
+        totals.firstMoveCutoffs += stats.firstMoveCutoffs;
+        totals.movesBeforeCutoff += stats.movesBeforeCutoff;
+    }
+    std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+    totals.ms = elapsed.count();
+    return totals;
+}
+
+// Move ordering with and without everything but the hash move. Better ordering cuts off sooner, so the tree
+// shrinks and more cut nodes fail high on their first move. Pruning is off so only the ordering differs
+void benchOrdering() {
+    const int depth = 6;
+    std::cout << "ordering: depth " << depth << " searches\n";
+
+    for (bool enabled : {false, true}) {
+        SearchOptions options{enabled, false, false, false, false};
+        SearchTotals totals = searchPositions(options, depth);
+
+        std::cout << "  " << (enabled ? "ordered" : "hash move only") << ": " << totals.nodes << " nodes in "
+                  << totals.ms << " ms, first move cutoff rate " << (double) totals.firstMoveCutoffs / totals.cutNodes
+                  << ", " << (double) totals.movesBeforeCutoff / totals.cutNodes << " moves per cutoff\n";
+    }
+}
+
+// Node counts to the same depth with no pruning, each pruning technique alone, and all of them together
+void benchPruning() {
+    const int depth = 7;
+    std::cout << "pruning: depth " << depth << " searches\n";
+
+    SearchOptions none{true, false, false, false, false};
+    SearchOptions all{};
+    const vector<std::pair<string, SearchOptions>> configurations{
+            {"none", none},
+            {"null move", {true, true, false, false, false}},
+            {"late move reductions", {true, false, true, false, false}},
+            {"reverse futility", {true, false, false, true, false}},
+            {"futility", {true, false, false, false, true}},
+            {"all", all}
+    };
+
+    uint64_t baseline = 0;
+    for (const auto& configuration : configurations) {
+        SearchTotals totals = searchPositions(configuration.second, depth);
+        if (!baseline) {
+            baseline = totals.nodes;
+        }
+
+        std::cout << "  " << configuration.first << ": " << totals.nodes << " nodes in " << totals.ms << " ms";
+        if (totals.nodes != baseline) {
+            std::cout << " (" << (double) baseline / totals.nodes << "x fewer nodes)";
+        }
+        std::cout << "\n";
+    }
+}
+
+// Time to reach the same depth on each position with 1, 2, 4 and 8 threads. Helpers only speed the main thread up
+// by filling the transposition table, so this won't scale past the number of cores
+void benchThreads() {
+    const int depth = 10;
+    std::cout << "threads: time to depth " << depth << " (" << std::thread::hardware_concurrency() << " cores)\n";
+
+    double baseline = 0;
+    for (unsigned threads : {1u, 2u, 4u, 8u}) {
+        TranspositionTable tt{64};
+        Search search{tt};
+        search.setThreads(threads);
+        SearchLimits limits;
+        limits.depth = depth;
+
+        uint64_t nodes = 0;
+        auto start = std::chrono::steady_clock::now();
+        for (const string& fen : positions) {
+            tt.clear();
+            search.clear();
+            nodes += search.think(parseFen(fen), limits).nodes;
+        }
+        std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+        if (threads == 1) {
+            baseline = elapsed.count();
+        }
+
+        std::cout << "  " << threads << " threads: " << elapsed.count() << " ms, " << nodes << " nodes, "
+                  << nodes / elapsed.count() * 1000 << " nps, speedup " << baseline / elapsed.count() << "x\n";
+    }
+}
+
+// Evaluations per second with the piece-square tables, and with the network both built from scratch and updated
+// from the parent position's accumulator, as the search does. The network's weights are random, which doesn't
+// change how long it takes
+void benchNnue() {
+    Nnue network;
+    network.randomize(1);
+
+    struct Child {
+        GameState* gs;
+        Move move;
+        const Nnue::Accumulator* parent;
+    };
+
+    vector<GameState> states;
+    for (const string& fen : positions) {
+        states.push_back(parseFen(fen));
+    }
+    vector<Nnue::Accumulator> parents(states.size());
+    vector<Child> children;
+    for (size_t i = 0; i < states.size(); i++) {
+        network.refresh(states[i], parents[i]);
+        for (Move m : states[i].generateMoves()) {
+            children.push_back({&states[i], m, &parents[i]});
+        }
+    }
+
+    std::cout << "nnue: evaluating the " << children.size() << " children of the benchmark positions ("
+              << Nnue::kernelName() << " kernels)\n";
+
+    auto report = [](double ns) {
+        std::cout << "    " << 1e9 / ns << " evals/s\n";
+    };
+
+    report(timeIt("piece-square tables", children.size(), [&]() {
+        uint64_t sum = 0;
+        for (const Child& child : children) {
+            child.gs->makeMove(child.move);
+            sum += Search::evaluate(*child.gs);
+            child.gs->unmakeMove();
+        }
+        return sum;
+    }));
+
+    report(timeIt("network, refreshed", children.size(), [&]() {
+        uint64_t sum = 0;
+        for (const Child& child : children) {
+            child.gs->makeMove(child.move);
+            sum += network.evaluate(*child.gs);
+            child.gs->unmakeMove();
+        }
+        return sum;
+    }));
+
+    Nnue::Accumulator acc;
+    report(timeIt("network, updated", children.size(), [&]() {
+        uint64_t sum = 0;
+        for (const Child& child : children) {
+            child.gs->makeMove(child.move);
+            network.update(*child.parent, child.gs->getLastChanges(), acc);
+            sum += network.evaluate(acc, child.gs->getToAct());
+            child.gs->unmakeMove();
+        }
+        return sum;
+    }));
+}
+
+int main(int argc, char** argv) {
+    const vector<std::pair<string, std::function<void()>>> benchmarks{
+            {"sliders", benchSliders},
+            {"attacks", benchAttacks},
+            {"moves", benchMoves},
+            {"ordering", benchOrdering},
+            {"pruning", benchPruning},
+            {"threads", benchThreads},
+            {"nnue", benchNnue}
+    };
+
+    for (auto& benchmark : benchmarks) {
+        bool selected = argc < 2;
+        for (int i = 1; i < argc; i++) {
+            selected |= benchmark.first == argv[i];
+        }
+
+        if (selected) {
+            benchmark.second();
+        }
+    }
+
+    return 0;
+}
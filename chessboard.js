@@ -4,6 +4,7 @@ const whiteMoveColor = '#F6F681';
 const blackColor = '#769656';
 const blackHoverColor = '#B76E79';
 const blackMoveColor = '#BBCA44';
+const opponentThinkTime = 1000; // Milliseconds the computer spends choosing each move
 const Pieces = {'P': 0, 'N': 1, 'B': 2, 'R': 3, 'Q': 4, 'K': 5, 'p': 6, 'n': 7, 'b': 8, 'r': 9, 'q': 10, 'k': 11};
 const filenames = ['img/wpawn.svg', 'img/wknight.svg', 'img/wbishop.svg',
     'img/wrook.svg', 'img/wqueen.svg', 'img/wking.svg',
@@ -116,6 +117,7 @@ function Chessboard(parentElement, engine) {
 
     // This is the "per game" state
     this.holdingPiece = false;
+    this.gameNumber = 0; // Lets replies the engine was thinking about before a new game be ignored
     this.pieceString = this.engineAPI.getPieces();
     this.resize();
 }
@@ -379,9 +381,39 @@ Chessboard.prototype.movePiece = function () {
         }
 
         this.dropPiece(putBack);
+
+        if (!putBack && !this.awaitingPromotion) {
+            this.opponentMove();
+        }
     }
 };
 
+// Has the computer reply for the side to move. engineAPI.computerMove resolves with the move it made, if any
+Chessboard.prototype.opponentMove = function () {
+    if (this.gameOver || !this.engineAPI.computerMove) {
+        return;
+    }
+
+    this.disableMoves();
+
+    const game = this.gameNumber;
+    this.engineAPI.computerMove(opponentThinkTime).then((move) => {
+        // A new game was started while the engine was thinking
+        if (game !== this.gameNumber) {
+            return;
+        }
+
+        if (move) {
+            this.setLastMoveHighlights(this.reverseIfNeeded(move.from), this.reverseIfNeeded(move.to));
+            this.updatePieces();
+        }
+
+        if (!this.gameOver) {
+            this.enableMoves();
+        }
+    });
+};
+
 Chessboard.prototype.drawOverlay = function () {
     if (this.holdingPiece) {
         this.drawCtx.clearRect(0, 0, this.boardSize, this.boardSize);
@@ -425,9 +457,11 @@ Chessboard.prototype.makePromoDialog = function (isWhite) {
         for(let b of promoDialog.buttons) {
             b.addEventListener(type, () => {
                 promoDialog.style.visibility = 'hidden';
+                this.awaitingPromotion = false;
                 this.engineAPI.promote(b.pieceCode);
                 this.updatePieces();
                 this.enableMoves();
+                this.opponentMove();
             }, false);
         }
     };
@@ -473,6 +507,7 @@ Chessboard.prototype.enableMoves = function () {
 
 Chessboard.prototype.promptForPromotion = function () {
     this.disableMoves();
+    this.awaitingPromotion = true;
 
     // Draw the pawn on the correct square
     const promoSquare = this.squareFromCoords(this.userX, this.userY);
@@ -491,6 +526,7 @@ Chessboard.prototype.promptForPromotion = function () {
 
 Chessboard.prototype.showVictoryDialog = function () {
     this.disableMoves();
+    this.gameOver = true;
 
     let victoryDialog = this.engineAPI.whiteToMove() ? this.dialogs.blackVictory : this.dialogs.whiteVictory;
     victoryDialog.style.visibility = 'visible';
@@ -498,6 +534,7 @@ Chessboard.prototype.showVictoryDialog = function () {
 
 Chessboard.prototype.showStalemateDialog = function () {
     this.disableMoves();
+    this.gameOver = true;
     this.dialogs.stalemate.style.visibility = 'visible';
 };
 
@@ -510,6 +547,9 @@ Chessboard.prototype.newGame = function (reverseBoard = false) {
     this.reverseBoard = reverseBoard;
 
     this.holdingPiece = false;
+    this.awaitingPromotion = false;
+    this.gameOver = false;
+    this.gameNumber++;
     this.engineAPI.newGame();
     this.clearDialogs();
     this.updatePieces(true);
@@ -522,6 +562,11 @@ Chessboard.prototype.newGame = function (reverseBoard = false) {
     this.hoverSquare = undefined;
     this.lastMovedFrom = undefined;
     this.lastMovedTo = undefined;
+
+    // Playing black, so the computer opens
+    if (reverseBoard) {
+        this.opponentMove();
+    }
 };
 
 loadSVGs();
@@ -0,0 +1,60 @@
+// Runs the engine off the page's thread. Built by ca3_compile_worker; engine.js is the page's side.
+//
+// Messages in:  {type: 'newGame'}
+//               {type: 'loadNetwork', bytes: ArrayBuffer holding a network file (see src/Nnue.h)}
+//               {type: 'think', id, moves: Uint16Array of packed moves, limits: {depth, timeMs, nodes}}
+// Messages out: {type: 'ready'} once the module has loaded
+//               {type: 'info', id, depth, score, nodes, timeMs, move} after each search iteration
+//               {type: 'bestMove', id, move} when a search ends, with move -1 if there is none
+// Moves are packed into 16 bits as by Move::pack: from | to << 6 | type << 12
+
+importScripts('engine-module.js');
+
+let engine = undefined;
+let pending = []; // Messages that arrived before the module was ready
+let searchId = 0;
+
+function handle(message) {
+    switch (message.type) {
+        case 'newGame':
+            engine.newGame();
+            break;
+        case 'loadNetwork':
+            if (!engine.loadNetwork(message.bytes)) {
+                console.log('engine-worker: not a network, evaluating with piece-square tables');
+            }
+            break;
+        case 'think': {
+            const limits = message.limits || {};
+            searchId = message.id;
+            engine.setPosition(message.moves);
+            const move = engine.think(limits.depth || 0, limits.timeMs || 0, limits.nodes || 0);
+            postMessage({type: 'bestMove', id: message.id, move: move});
+            break;
+        }
+        default:
+            console.log('engine-worker: unknown message ' + message.type);
+            break;
+    }
+}
+
+onmessage = (e) => {
+    if (engine) {
+        handle(e.data);
+    } else {
+        pending.push(e.data);
+    }
+};
+
+ChessAmateurEngine({
+    onRuntimeInitialized() {
+        engine = this;
+        engine.registerInfoHandler((depth, score, nodes, timeMs, move) => {
+            postMessage({type: 'info', id: searchId, depth, score, nodes, timeMs, move});
+        });
+
+        postMessage({type: 'ready'});
+        pending.forEach(handle);
+        pending = [];
+    }
+});
@@ -0,0 +1,181 @@
+// Promise-based access to the engine running in a worker (engine-worker.js), so searches don't block the page.
+//
+// const engine = new Engine();
+// engine.onInfo = (info) => console.log(info.depth, info.score);
+// engine.setPosition(ChessAmateur.getMoveHistory());
+// engine.think({timeMs: 1000}).then((move) => { if (move) ChessAmateur.playMove(move.packed); });
+//
+// Resolved moves are {from, to, packed}, or null if there's no legal move.
+// TimeSlicedEngine below offers the same interface without a worker.
+// A worker can't hear a message while it's searching, so stop() ends the search by replacing the worker.
+// The promise resolves with the best move of the last completed iteration (null if none completed), but the
+// replacement worker starts with an empty hash table.
+// If the worker can't start, eg because engine-module.js hasn't been built, searches reject with an Error
+
+function unpack(packed) {
+    return packed < 0 ? null : {from: packed & 63, to: (packed >> 6) & 63, packed: packed};
+}
+
+export default class Engine {
+    constructor(workerUrl = './engine-worker.js') {
+        this.workerUrl = workerUrl;
+        this.onInfo = undefined; // Called with each iteration's {depth, score, nodes, timeMs, move}
+        this.moves = new Uint16Array(0);
+        this.nextId = 0;
+        this.search = undefined; // The search in progress: {id, resolve, reject, best}
+        this.network = undefined; // The bytes of the network file, kept to send to replacement workers
+        this.error = undefined; // Set if the worker failed to load
+        this.startWorker();
+    }
+
+    startWorker() {
+        this.worker = new Worker(this.workerUrl);
+        this.worker.onmessage = (e) => this.receive(e.data);
+        this.worker.onerror = (e) => this.fail(new Error('Engine worker failed: ' + e.message));
+        if (this.network) {
+            this.worker.postMessage({type: 'loadNetwork', bytes: this.network});
+        }
+    }
+
+    receive(message) {
+        if (!this.search || message.id !== this.search.id) {
+            return; // 'ready', or from a search that was stopped
+        }
+
+        if (message.type === 'info') {
+            const info = {depth: message.depth, score: message.score, nodes: message.nodes,
+                timeMs: message.timeMs, move: unpack(message.move)};
+            this.search.best = info.move;
+            if (this.onInfo) {
+                this.onInfo(info);
+            }
+        } else if (message.type === 'bestMove') {
+            this.finish(unpack(message.move));
+        }
+    }
+
+    fail(error) {
+        this.error = error;
+        if (this.search) {
+            const reject = this.search.reject;
+            this.search = undefined;
+            reject(error);
+        }
+    }
+
+    finish(move) {
+        const resolve = this.search.resolve;
+        this.search = undefined;
+        resolve(move);
+    }
+
+    // The game to search next, as the moves played from the start, packed (see Game::getMoveHistory)
+    setPosition(moves) {
+        this.moves = Uint16Array.from(moves);
+    }
+
+    // Fetches a network file (see src/Nnue.h) for the engine to evaluate with from the next search on. Resolves once
+    // it's been sent to the worker
+    loadNetwork(url) {
+        return fetch(url)
+            .then((response) => response.arrayBuffer())
+            .then((bytes) => {
+                this.network = bytes;
+                this.worker.postMessage({type: 'loadNetwork', bytes: bytes});
+            });
+    }
+
+    newGame() {
+        this.stop();
+        this.moves = new Uint16Array(0);
+        this.worker.postMessage({type: 'newGame'});
+    }
+
+    // limits: {depth, timeMs, nodes}, any of which may be left out. Starting a search stops any other
+    think(limits = {}) {
+        this.stop();
+        if (this.error) {
+            return Promise.reject(this.error);
+        }
+
+        return new Promise((resolve, reject) => {
+            this.search = {id: this.nextId++, resolve: resolve, reject: reject, best: null};
+            const moves = this.moves.slice();
+            this.worker.postMessage({type: 'think', id: this.search.id, moves: moves, limits: limits}, [moves.buffer]);
+        });
+    }
+
+    stop() {
+        if (!this.search) {
+            return;
+        }
+
+        this.worker.terminate();
+        this.startWorker();
+        this.finish(this.search.best);
+    }
+}
+
+// Slices of this many microseconds leave most of each 16ms frame for the page
+const SLICE_US = 8000;
+
+// The same interface for pages that can't use workers: searches the page's own game (the module from
+// ca3_compile_emsdk) a slice at a time between frames, so it doesn't need setPosition. stop() keeps the best
+// move so far and everything in the hash table
+export class TimeSlicedEngine {
+    constructor(module) {
+        this.module = module;
+        this.onInfo = undefined;
+        this.search = undefined; // The search in progress: {resolve, best, timer}
+    }
+
+    setPosition() {
+    }
+
+    // The page's module always evaluates with piece-square tables
+    loadNetwork() {
+        return Promise.resolve();
+    }
+
+    newGame() {
+        this.stop();
+    }
+
+    think(limits = {}) {
+        this.stop();
+
+        return new Promise((resolve) => {
+            this.search = {resolve: resolve, best: null, timer: undefined};
+            this.module.startSearch(limits.depth || 0, limits.timeMs || 0, limits.nodes || 0);
+            this.step();
+        });
+    }
+
+    step() {
+        const report = this.module.searchStep(SLICE_US);
+        this.search.best = unpack(report.move);
+        if (this.onInfo) {
+            this.onInfo({depth: report.depth, score: report.score, nodes: report.nodes, timeMs: report.timeMs,
+                move: this.search.best});
+        }
+
+        if (report.done) {
+            this.finish();
+        } else {
+            this.search.timer = setTimeout(() => this.step(), 0);
+        }
+    }
+
+    finish() {
+        const search = this.search;
+        this.search = undefined;
+        clearTimeout(search.timer);
+        search.resolve(search.best);
+    }
+
+    stop() {
+        if (this.search) {
+            this.finish();
+        }
+    }
+}
@@ -0,0 +1,130 @@
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+#include "src/Error.h"
+#include "src/Perft.h"
+
+// Native perft driver for checking and timing move generation
+// Usage: perft [depth] [--fen FEN] [--divide] [--threads N] [--hash MB] [--suite]
+
+using std::string;
+using std::vector;
+
+struct SuitePosition {
+    const char* name;
+    const char* fen;
+    vector<uint64_t> counts; // counts[d - 1] is the perft count at depth d
+};
+
+// Reference counts from https://www.chessprogramming.org/Perft_Results
+const vector<SuitePosition> suite{
+        {"start",      "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1",
+                {20, 400, 8902, 197281, 4865609, 119060324, 3195901860}},
+        {"kiwipete",   "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",
+                {48, 2039, 97862, 4085603, 193690690, 8031647685}},
+        {"endgame",    "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1",
+                {14, 191, 2812, 43238, 674624, 11030083, 178633661}},
+        {"promotion",  "r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1",
+                {6, 264, 9467, 422333, 15833292, 706045033}},
+        {"buggy",      "rnbq1k1r/pp1Pbppp/2p5/8/2B5/8/PPP1NnPP/RNBQK2R w KQ - 1 8",
+                {44, 1486, 62379, 2103487, 89941194}},
+        {"middlegame", "r4rk1/1pp1qppp/p1np1n2/2b1p1B1/2B1P1b1/P1NP1N2/1PP1QPPP/R4RK1 w - - 0 10",
+                {46, 2079, 89890, 3894594, 164075551, 6923051137}}
+};
+
+struct Options {
+    int depth = 5;
+    string fen = suite[0].fen;
+    bool divide = false;
+    bool runSuite = false;
+    unsigned threads = 1;
+    size_t hashMb = 0;
+};
+
+// Runs perft and prints the count, time and speed. Returns the node count
+uint64_t timedPerft(const GameState& gs, const Options& opts, PerftCache* cache) {
+    auto start = std::chrono::steady_clock::now();
+    vector<PerftDivision> divisions = perftDivide(gs, opts.depth, opts.threads, cache);
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+    uint64_t nodes = 0;
+    for (auto& d : divisions) {
+        nodes += d.nodes;
+        if (opts.divide) {
+            std::cout << moveToString(d.move) << ": " << d.nodes << "\n";
+        }
+    }
+
+    // Depth 0 has no root moves to divide, but still counts as one node
+    if (opts.depth < 1) {
+        nodes = 1;
+    }
+
+    double seconds = elapsed.count();
+    std::cout << "depth " << opts.depth << " nodes " << nodes << " time " << (int) (seconds * 1000) << "ms nps "
+              << (seconds > 0 ? (uint64_t) (nodes / seconds) : 0) << std::endl;
+    return nodes;
+}
+
+int main(int argc, char** argv) {
+    Options opts;
+
+    for (int i = 1; i < argc; i++) {
+        string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+
+        if (arg == "--fen" && hasValue) {
+            opts.fen = argv[++i];
+        } else if (arg == "--threads" && hasValue) {
+            opts.threads = (unsigned) std::max(1, std::stoi(argv[++i]));
+        } else if (arg == "--hash" && hasValue) {
+            opts.hashMb = (size_t) std::stoul(argv[++i]);
+        } else if (arg == "--divide") {
+            opts.divide = true;
+        } else if (arg == "--suite") {
+            opts.runSuite = true;
+        } else if (!arg.empty() && std::isdigit(arg[0])) {
+            opts.depth = std::stoi(arg);
+        } else {
+            std::cerr << "Usage: perft [depth] [--fen FEN] [--divide] [--threads N] [--hash MB] [--suite]\n";
+            return 1;
+        }
+    }
+
+    std::unique_ptr<PerftCache> cache;
+    if (opts.hashMb > 0) {
+        cache.reset(new PerftCache{opts.hashMb});
+    }
+
+    if (!opts.runSuite) {
+        try {
+            timedPerft(parseFen(opts.fen), opts, cache.get());
+        } catch (Error& e) {
+            std::cerr << e.what() << "\n";
+            return 1;
+        }
+        return 0;
+    }
+
+    // Suite: run every position to the requested depth (or the deepest known count) and compare
+    int failures = 0;
+    int maxDepth = opts.depth;
+    for (const SuitePosition& pos : suite) {
+        opts.depth = std::max(1, std::min(maxDepth, (int) pos.counts.size()));
+        std::cout << pos.name << ": ";
+
+        uint64_t nodes = timedPerft(parseFen(pos.fen), opts, cache.get());
+        uint64_t expected = pos.counts[opts.depth - 1];
+        if (nodes != expected) {
+            std::cout << "  FAILED: expected " << expected << "\n";
+            failures++;
+        }
+    }
+
+    std::cout << (failures ? "FAILED" : "passed") << std::endl;
+    return failures ? 1 : 0;
+}
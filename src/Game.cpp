@@ -4,6 +4,8 @@
 #include <iostream>
 #include "Game.h"
 #include "GameState.h"
+#include "Search.h"
+#include "TranspositionTable.h"
 
 using namespace CA3;
 using std::string;
@@ -28,7 +30,11 @@ public:
 
     bool canMove(Square square);
 
-    vector<Move> getMoves();
+    MoveView getMoves();
+
+    bool isLegal(Move m);
+
+    vector<Move> getMoveHistory();
 
     MoveResult promote(PromotionChoice toPromote);
 
@@ -36,10 +42,26 @@ public:
 
     Color getActivePlayer();
 
+    uint64_t getKey();
+
+    Move bestMove(const SearchLimits& limits);
+
+    void startSearch(const SearchLimits& limits);
+
+    bool searchStep(int64_t budgetUs, SearchResult& progress);
+
+    void setSearchThreads(unsigned count);
+
 private:
+    static constexpr size_t HASH_MEGABYTES = 8;
+
     GameState gs{};
+    TranspositionTable tt{HASH_MEGABYTES};
+    Search search{tt};
+    vector<uint64_t> history; // Keys of the positions before each move, for repetition detection
     vector<Move> moves;
-    vector<Move> possibleMoves;
+    MoveList possibleMoves;
+    bool possibleMovesStale{true}; // Set by every move, since the list is only generated when asked for
     Move incompleteMove{};
 
     MoveResult checkGameOver();
@@ -148,7 +170,8 @@ void GameImpl::setBoard(string newBoard) {
     gs.setWhiteKingLocation(wk);
     gs.setBlackKingLocation(bk);
 
-    possibleMoves = gs.generateMoves();
+    history.clear();
+    possibleMovesStale = true;
 }
 
 MoveResult GameImpl::tryMove(Square from, Square to) {
@@ -161,20 +184,45 @@ MoveResult GameImpl::tryMove(Square from, Square to) {
 }
 
 MoveResult GameImpl::makeMove(Move m) {
+    history.push_back(gs.getKey());
     gs.makeMove(m);
     moves.emplace_back(m);
+    possibleMovesStale = true;
 
     return checkGameOver();
 }
 
 void GameImpl::setActivePlayer(Color c) {
     gs.setToAct(c);
+    possibleMovesStale = true;
 }
 
 Color GameImpl::getActivePlayer() {
     return gs.getToAct();
 }
 
+uint64_t GameImpl::getKey() {
+    return gs.getKey();
+}
+
+Move GameImpl::bestMove(const SearchLimits& limits) {
+    return search.think(gs, limits, history).bestMove;
+}
+
+void GameImpl::startSearch(const SearchLimits& limits) {
+    search.startSearch(gs, limits, history);
+}
+
+bool GameImpl::searchStep(int64_t budgetUs, SearchResult& progress) {
+    bool searching = search.searchStep(budgetUs);
+    progress = search.currentResult();
+    return searching;
+}
+
+void GameImpl::setSearchThreads(unsigned count) {
+    search.setThreads(count);
+}
+
 MoveResult GameImpl::promote(PromotionChoice toPromote) {
     bool capture = gs[incompleteMove.to] != NO_PIECE;
     MoveType type;
@@ -200,8 +248,7 @@ MoveResult GameImpl::promote(PromotionChoice toPromote) {
 
 MoveResult GameImpl::checkGameOver() {
     MoveResult result = GAME_CONTINUES;
-    possibleMoves = gs.generateMoves();
-    if (possibleMoves.empty()) {
+    if (!gs.hasLegalMove()) {
         if (gs.currentPlayerInCheck()) {
             result = gs.getToAct() == WHITE ? BLACK_WINS : WHITE_WINS;
         } else {
@@ -212,10 +259,22 @@ MoveResult GameImpl::checkGameOver() {
     return result;
 }
 
-vector<Move> GameImpl::getMoves() {
+MoveView GameImpl::getMoves() {
+    if (possibleMovesStale) {
+        gs.generateMoves(possibleMoves);
+        possibleMovesStale = false;
+    }
     return possibleMoves;
 }
 
+bool GameImpl::isLegal(Move m) {
+    return gs.isLegal(m);
+}
+
+vector<Move> GameImpl::getMoveHistory() {
+    return moves;
+}
+
 bool GameImpl::canMove(Square square) {
     return isFriendly(gs[square], gs.getToAct());
 }
@@ -223,6 +282,10 @@ bool GameImpl::canMove(Square square) {
 void GameImpl::newGame() {
     moves.clear();
     possibleMoves.clear();
+    possibleMovesStale = true;
+    history.clear();
+    tt.clear();
+    search.clear();
     gs = GameState{};
 }
 
@@ -350,9 +413,23 @@ void Game::setActivePlayer(Color c) { pimpl->setActivePlayer(c); }
 
 Color Game::getActivePlayer() { return pimpl->getActivePlayer(); }
 
+uint64_t Game::getKey() { return pimpl->getKey(); }
+
+Move Game::bestMove(const SearchLimits& limits) { return pimpl->bestMove(limits); }
+
+void Game::startSearch(const SearchLimits& limits) { pimpl->startSearch(limits); }
+
+bool Game::searchStep(int64_t budgetUs, SearchResult& progress) { return pimpl->searchStep(budgetUs, progress); }
+
+void Game::setSearchThreads(unsigned count) { pimpl->setSearchThreads(count); }
+
 MoveResult Game::promote(PromotionChoice toPromote) { return pimpl->promote(toPromote); }
 
-vector<Move> Game::getMoves() { return pimpl->getMoves(); }
+MoveView Game::getMoves() { return pimpl->getMoves(); }
+
+bool Game::isLegal(Move m) { return pimpl->isLegal(m); }
+
+vector<Move> Game::getMoveHistory() { return pimpl->getMoveHistory(); }
 
 bool Game::canMove(Square square) { return pimpl->canMove(square); }
 
@@ -5,10 +5,14 @@
 #include "Error.h"
 #include "piece.h"
 #include "Move.h"
+#include "MoveList.h"
 
 enum MoveResult { GAME_CONTINUES = 0, WHITE_WINS = 1, BLACK_WINS = 2, STALEMATE = 3, CHOOSE_PROMOTION = 4 };
 enum PromotionChoice { QUEEN = 0, ROOK = 1, BISHOP = 2, KNIGHT = 3};
 
+struct SearchLimits;
+struct SearchResult;
+
 class GameImpl;
 class Game {
 public:
@@ -26,13 +30,38 @@ public:
 
     bool canMove(CA3::Square square);
 
-    std::vector<Move> getMoves();
+    // The legal moves for the active player, viewed in place. Generated on the first call after each move, and
+    // valid until the next move or new game
+    MoveView getMoves();
+
+    // Whether m is a legal move for the active player, eg one found by searching the position. Doesn't depend on
+    // getMoves having been called
+    bool isLegal(Move m);
+
+    // Moves made since the game started, in order
+    std::vector<Move> getMoveHistory();
 
     MoveResult promote(PromotionChoice choice);
 
     void setActivePlayer(CA3::Color c);
     CA3::Color getActivePlayer();
 
+    // Zobrist key of the current position. Equal positions have equal keys
+    uint64_t getKey();
+
+    // Searches for the best move for the active player within the limits (see Search.h).
+    // Returns a default Move if the game is over. The move is not made
+    Move bestMove(const SearchLimits& limits);
+
+    // The same search as bestMove, run a slice at a time so the caller is never blocked for long: call
+    // searchStep until it returns false, then make progress.bestMove. Each step runs for about budgetUs
+    // microseconds and leaves the deepest completed iteration so far in progress
+    void startSearch(const SearchLimits& limits);
+    bool searchStep(int64_t budgetUs, SearchResult& progress);
+
+    // Threads bestMove searches with. Defaults to 1
+    void setSearchThreads(unsigned count);
+
     ~Game();
 private:
     std::unique_ptr<GameImpl> pimpl;
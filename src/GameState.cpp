@@ -1,3 +1,4 @@
+#include <algorithm>
 #include <cstring>
 
 #include "GameState.h"
@@ -10,6 +11,18 @@ constexpr int signOf(int x) {
     return (x > 0) - (x < 0);
 }
 
+// Adds a pawn move, expanded into one move per promotion piece if it reaches the last row
+static void addPawnMove(MoveList& moves, Square from, Square to, bool capture) {
+    if (onPromotionRow(to)) {
+        moves.emplace_back(from, to, capture ? PROMOTION_QUEEN_CAPTURE : PROMOTION_QUEEN);
+        moves.emplace_back(from, to, capture ? PROMOTION_KNIGHT_CAPTURE : PROMOTION_KNIGHT);
+        moves.emplace_back(from, to, capture ? PROMOTION_ROOK_CAPTURE : PROMOTION_ROOK);
+        moves.emplace_back(from, to, capture ? PROMOTION_BISHOP_CAPTURE : PROMOTION_BISHOP);
+    } else {
+        moves.emplace_back(from, to, capture ? CAPTURE : MOVE);
+    }
+}
+
 // Separate validation and castling checks so we can generate errors
 enum GameState::CastleResult : uint8_t {
     CASTLE_SUCCESS, CASTLE_ERR_MOVED, CASTLE_ERR_BLOCKED, CASTLE_ERR_KING_CHECK, CASTLE_ERR_SQUARE_CHECK
@@ -17,150 +30,106 @@ enum GameState::CastleResult : uint8_t {
 
 void GameState::makeEmpty() {
     memset(pieces, NO_PIECE, 64);
+    memset(byType, 0, sizeof(byType));
+    memset(byColor, 0, sizeof(byColor));
     whiteKingSquare = INVALID_SQUARE;
     whiteRookWest = INVALID_SQUARE;
     whiteRookEast = INVALID_SQUARE;
     blackKingSquare = INVALID_SQUARE;
     blackRookWest = INVALID_SQUARE;
     blackRookEast = INVALID_SQUARE;
+    enPassantSquare = INVALID_SQUARE;
     toAct = WHITE;
+    undoCount = 0;
+    key = 0;
+    pieceSquareScore = {0, 0};
+    phase = 0;
+    attacksValid = 0;
+    checksValid = 0;
 }
 
-bool GameState::isBlocked(const Square from, const Square to, const Direction dir) const {
-    Square checked;
-    int inc = dirIncrement(dir);
-    for (Square const* p = dirPtr(dir, from); (checked = *p) != INVALID_SQUARE; p += inc) {
-        if (checked == to) {
-            return false;
-        }
+uint64_t GameState::computeKey() const {
+    uint64_t k = 0;
+    for (Square s = 0; s < 64; s++) {
+        k ^= pieceKey(pieces[s], s);
+    }
 
-        if (pieces[checked] != NO_PIECE) {
-            return true;
-        }
+    if (toAct == BLACK) {
+        k ^= zobristKeys.blackToAct;
     }
 
-    return false;
+    k ^= enPassantKey(enPassantSquare);
+    k ^= castleKey(WHITE_EAST_CASTLE, whiteRookEast);
+    k ^= castleKey(WHITE_WEST_CASTLE, whiteRookWest);
+    k ^= castleKey(BLACK_EAST_CASTLE, blackRookEast);
+    k ^= castleKey(BLACK_WEST_CASTLE, blackRookWest);
+    return k;
 }
 
-// Returns the nearest blocked square in a direction
-Square GameState::nearestOccupiedInDir(Square from, Direction dir) const {
-    int inc = dirIncrement(dir);
-    Square to;
-
-    for (Square const* p = dirPtr(dir, from); (to = *p) != INVALID_SQUARE; p += inc) {
-        if (pieces[to] != NO_PIECE) {
-            return to;
-        }
+TaperedScore GameState::computePieceSquareScore() const {
+    TaperedScore score{0, 0};
+    for (Square s = 0; s < 64; s++) {
+        score = score + CA3::pieceSquareScore(pieces[s], s);
     }
-
-    return INVALID_SQUARE;
+    return score;
 }
 
-bool GameState::isThreatenedBySquare(Square defendingSquare, Square attackingSquare) const {
-    Piece attackingPiece = pieces[attackingSquare];
-    Color attackerColor = pieceColor(attackingPiece);
-
-    PieceCharacteristic attackerType = pieceType(attackingPiece);
-
-    if (attackerType == PIECE_PAWN) {
-        return validPawnAttack(attackingSquare, defendingSquare, attackerColor);
-    } else if (attackerType == PIECE_KING) {
-        return inKingRange(attackingSquare, defendingSquare);
-    } else if (attackerType == PIECE_KNIGHT) {
-        return validKnightMovement(attackingSquare, defendingSquare);
+int GameState::computePhase() const {
+    int total = 0;
+    for (Square s = 0; s < 64; s++) {
+        total += phaseWeight(pieces[s]);
     }
+    return total;
+}
 
-    Direction dir = getDirection(attackingSquare, defendingSquare);
-    if (dir == INVALID_DIRECTION) {
-        return false;
+Bitboard GameState::attackedBy(const Color c) const {
+    int side = colorIndex(c);
+    if (!(attacksValid & (1u << side))) {
+        Bitboard occupancy = occupied();
+        Bitboard squares = EMPTY_BOARD;
+        for (Bitboard remaining = colorBoard(c); remaining;) {
+            Square s = popLsb(remaining);
+            squares |= pieceAttacks(pieces[s], s, occupancy);
+        }
+        attacks[side] = squares;
+        attacksValid |= 1u << side;
     }
+    return attacks[side];
+}
 
-    // If it's a straight direction, check for blocking pieces
-    Square toCheck;
-    int inc = dirIncrement(dir);
+bool GameState::isBlocked(const Square from, const Square to) const {
+    return squaresBetween(from, to) & occupied();
+}
 
-    for (Square const* p = dirPtr(dir, attackingSquare); (toCheck = *p) != INVALID_SQUARE; p += inc) {
-        if (toCheck == defendingSquare) {
-            if (isStraight(dir)) {
-                return isQueen(attackingPiece) || isRook(attackingPiece);
-            } else { // dir must be diagonal
-                return isQueen(attackingPiece) || isBishop(attackingPiece);
-            }
-        }
+Bitboard GameState::attackersTo(const Square s, const Bitboard occupancy) const {
+    Bitboard rooksQueens = byType[ROOK_INDEX] | byType[QUEEN_INDEX];
+    Bitboard bishopsQueens = byType[BISHOP_INDEX] | byType[QUEEN_INDEX];
+
+    // A pawn attacks s from the squares an enemy pawn on s would attack
+    return (pawnAttacks(s, BLACK) & pieceBoard(PIECE_PAWN, WHITE)) |
+           (pawnAttacks(s, WHITE) & pieceBoard(PIECE_PAWN, BLACK)) |
+           (knightAttacks(s) & byType[KNIGHT_INDEX]) |
+           (kingAttacks(s) & byType[KING_INDEX]) |
+           (rookAttacks(s, occupancy) & rooksQueens) |
+           (bishopAttacks(s, occupancy) & bishopsQueens);
+}
 
-        if (pieces[toCheck] != NO_PIECE) {
-            return false;
-        }
+bool GameState::isThreatenedBySquare(Square defendingSquare, Square attackingSquare) const {
+    Piece attackingPiece = pieces[attackingSquare];
+    if (attackingPiece == NO_PIECE) {
+        return false;
     }
 
-    return false;
+    return contains(pieceAttacks(attackingPiece, attackingSquare, occupied()), defendingSquare);
 }
 
 // Returns true if the square toCheck is threatened by enemyColor, and false otherwise.
+// A single lookup once the attack map has been built, but not worth building for one square
 bool GameState::isThreatenedBy(const Square toCheck, const Color enemyColor) const {
-    // The plan: loop through the directions, finding the first potential attacker in that direction
-    // Then check if the attacker can actually attack if it has limited range
-    // Check knights separately, they can jump
-    Square occupiedSquare;
-
-    // Check N, E, S, W
-    // Here we care about rooks, queens, and kings - nothing else can attack in these directions
-    for (Direction dir = RANKFILE_START; dir <= RANKFILE_END; dir++) {
-        occupiedSquare = nearestOccupiedInDir(toCheck, dir);
-
-        if (occupiedSquare == INVALID_SQUARE) {
-            continue;
-        }
-
-        Piece nearPiece = pieces[occupiedSquare];
-        if (isFriendly(nearPiece, enemyColor)) {
-            if (isRook(nearPiece) || isQueen(nearPiece)) {
-                return true; // Rook or queen is threatening
-            }
-
-            if (isKing(nearPiece) && inKingRange(toCheck, occupiedSquare)) {
-                return true; // King is threatening
-            }
-        }
+    if (attacksValid & (1u << colorIndex(enemyColor))) {
+        return contains(attacks[colorIndex(enemyColor)], toCheck);
     }
-
-    // In order, check NE, NW, SE, SW
-    // Here we care about pawns, bishops, queens, and kings - these can attack diagonally
-    for (Direction dir = DIAGONAL_START; dir <= DIAGONAL_END; dir++) {
-        occupiedSquare = nearestOccupiedInDir(toCheck, dir);
-        if (occupiedSquare == INVALID_SQUARE) {
-            continue;
-        }
-
-        Piece nearPiece = pieces[occupiedSquare];
-        if (isFriendly(nearPiece, enemyColor)) {
-            if (isBishop(nearPiece) || isQueen(nearPiece)) {
-                return true; // Bishop or queen is threatening
-            }
-
-            // Kings can attack with range 1, and pawn attacks can attack in a subset of those situations
-            if (inKingRange(toCheck, occupiedSquare)) {
-                if (isKing(nearPiece)) {
-                    return true;
-                }
-
-                if (isPawn(nearPiece) && validPawnAttack(occupiedSquare, toCheck, enemyColor)) {
-                    return true;
-                }
-            } // End range 1 check
-        }
-    } // End diagonal check
-
-    // Check knight threats
-    // Iterate through potential knight attackers and judge if they're an enemy
-    for (Square const* p = knightPtr(toCheck); (occupiedSquare = *p) != INVALID_SQUARE; ++p) {
-        Piece nearPiece = pieces[occupiedSquare];
-        if (isKnight(nearPiece) && isFriendly(nearPiece, enemyColor)) {
-            return true;
-        }
-    }
-
-    return false;
+    return attackersTo(toCheck, occupied()) & colorBoard(enemyColor);
 }
 
 // Throws an error if the move is not valid.
@@ -261,7 +230,7 @@ struct Move GameState::validateMove(Square from, Square to) {
             throw Error("Invalid move: bishops can't move like that");
         }
 
-        if (isBlocked(from, to, dir)) {
+        if (isBlocked(from, to)) {
             throw Error("Invalid move: bishop is blocked");
         }
     } else if (movingPieceType == PIECE_ROOK) { // Check rook moves
@@ -271,7 +240,7 @@ struct Move GameState::validateMove(Square from, Square to) {
             throw Error("Invalid move: rooks can't move like that");
         }
 
-        if (isBlocked(from, to, dir)) {
+        if (isBlocked(from, to)) {
             throw Error("Invalid move: rook is blocked");
         }
     } else if (movingPieceType == PIECE_QUEEN) { // Check queen moves
@@ -281,12 +250,12 @@ struct Move GameState::validateMove(Square from, Square to) {
             throw Error("Invalid move: queens can't move like that");
         }
 
-        if (isBlocked(from, to, dir)) {
+        if (isBlocked(from, to)) {
             throw Error("Invalid move: queen is blocked");
         }
     } else if (movingPieceType == PIECE_KING) {
         bool valid = true;
-        if (!inKingRange(from, to)) {
+        if (squareDistance(from, to) > 1) {
             // Check for castling, the only case when kings can move > 1 square
             if (targetPiece == NO_PIECE || (isRook(targetPiece) && isFriendly(targetPiece, color))) {
                 Direction dir = getDirection(from, to);
@@ -314,7 +283,8 @@ struct Move GameState::validateMove(Square from, Square to) {
 
     // Finally, it is illegal to put your own king in check
     // validateCastle ensures that castle moves aren't losing (isLosing doesn't handle castle cases)
-    if (moveType != CASTLE_EAST && moveType != CASTLE_WEST && isLosing(from, to)) {
+    bool losing = toAct == WHITE ? isLosing<WHITE>(from, to) : isLosing<BLACK>(from, to);
+    if (moveType != CASTLE_EAST && moveType != CASTLE_WEST && losing) {
         throw Error("Invalid move: move would put your king in check");
     }
 
@@ -322,62 +292,61 @@ struct Move GameState::validateMove(Square from, Square to) {
 }
 
 // Assumes otherwise valid from and to, and does NOT work in castle cases (validateCastle ensures the move isn't losing)
-bool GameState::isLosing(const Square from, const Square to) {
-    bool isLosing = false;
-    bool isEnPassant = false;
-
+template<Color us>
+bool GameState::isLosing(const Square from, const Square to) const {
     Piece moving = pieces[from];
-    Piece target = pieces[to];
 
-    Square epPawnSquare = INVALID_SQUARE;
-    Piece epPiece = NO_PIECE;
-
-    // Fake the move for a moment
-    // To do so, we must move the piece, deal with king locations, and remove captured pieces (including en passant)
-    Square kingSquare;
-    if (isKing(moving)) {
-        kingSquare = to;
-    } else {
-        kingSquare = toAct == WHITE ? whiteKingSquare : blackKingSquare;
-
-        // The only time this can be true is during an en passant (en passant square guaranteed empty)
-        if(to == enPassantSquare && isPawn(moving)) {
-            isEnPassant = true;
-            epPawnSquare = squareBehind(to, toAct);
-            epPiece = pieces[epPawnSquare]; // The captured piece will be behind the moved piece
-        }
-    }
-
-    pieces[from] = NO_PIECE;
-    pieces[to] = moving;
-    if(isEnPassant) {
-        pieces[epPawnSquare] = NO_PIECE;
+    // Rather than faking the move, work out which squares would be occupied and which enemies would remain
+    Square kingSquare = isKing(moving) ? to : (us == WHITE ? whiteKingSquare : blackKingSquare);
+    if (kingSquare == INVALID_SQUARE) {
+        return false;
     }
 
-    if (kingSquare != INVALID_SQUARE && isThreatenedBy(kingSquare, enemyColor(toAct))) {
-        isLosing = true;
-    }
+    Bitboard occupancy = (occupied() ^ squareBit(from)) | squareBit(to);
+    Bitboard enemies = colorBoard(enemyColor(us)) & ~squareBit(to);
 
-    // Put the board back the way it was
-    pieces[from] = moving;
-    pieces[to] = target;
-    if(isEnPassant) {
-        pieces[epPawnSquare] = epPiece;
+    // The only time this can be true is during an en passant (en passant square guaranteed empty)
+    if (to == enPassantSquare && isPawn(moving)) {
+        Bitboard captured = squareBit(squareBehind(to, us));
+        occupancy ^= captured;
+        enemies ^= captured;
     }
 
-    return isLosing;
+    return attackersTo(kingSquare, occupancy) & enemies;
 }
 
 // Returns true if a piece needs to be promoted
 void GameState::makeMove(Move m) {
+    if (toAct == WHITE) {
+        makeMoveFor<WHITE>(m);
+    } else {
+        makeMoveFor<BLACK>(m);
+    }
+}
+
+// Specialized for the side making the move, like the move generator
+template<Color us>
+void GameState::makeMoveFor(Move m) {
     Square from = m.from;
     Square to = m.to;
     Piece toMove = pieces[from];
     Square newEnPassantSquare = INVALID_SQUARE; // Gets cleared unless a pawn performs a forced march
 
+    // Save what the move destroys so unmakeMove can put it back
+    UndoRecord& undo = undoStack[undoCount++ % UNDO_STACK_SIZE];
+    undo.move = m;
+    undo.captured = pieces[to];
+    undo.enPassantSquare = enPassantSquare;
+    undo.whiteRookEast = whiteRookEast;
+    undo.whiteRookWest = whiteRookWest;
+    undo.blackRookEast = blackRookEast;
+    undo.blackRookWest = blackRookWest;
+    undo.key = key;
+    lastChanges.count = 0;
+
     // If king moves, update king location and invalidate all castling for that color
     if (isKing(toMove)) {
-        if (toAct == WHITE) {
+        if (us == WHITE) {
             whiteKingSquare = to;
             whiteRookEast = INVALID_SQUARE;
             whiteRookWest = INVALID_SQUARE;
@@ -390,7 +359,7 @@ void GameState::makeMove(Move m) {
 
     // If rook moves, invalidate its ability to castle
     if (isRook(toMove)) {
-        if (toAct == WHITE) {
+        if (us == WHITE) {
             if (from == whiteRookWest) {
                 whiteRookWest = INVALID_SQUARE;
             } else if (from == whiteRookEast) {
@@ -405,59 +374,75 @@ void GameState::makeMove(Move m) {
         }
     }
 
-    pieces[to] = toMove;
-    pieces[from] = NO_PIECE;
+    // If a rook is captured on its castling square, the enemy can no longer castle with it
+    if (m.isCapture()) {
+        if (to == whiteRookWest) {
+            whiteRookWest = INVALID_SQUARE;
+        } else if (to == whiteRookEast) {
+            whiteRookEast = INVALID_SQUARE;
+        } else if (to == blackRookWest) {
+            blackRookWest = INVALID_SQUARE;
+        } else if (to == blackRookEast) {
+            blackRookEast = INVALID_SQUARE;
+        }
+    }
+
+    // Castles move both pieces in their own case below. Anything else lands on to, capturing what was there
+    if (m.type != CASTLE_EAST && m.type != CASTLE_WEST) {
+        setPiece(to, toMove);
+        setPiece(from, NO_PIECE);
+    }
 
     // Do move specific tasks like setting newEnPassantSquare, removing en passant-ed pawns,
     // updating king squares, and invalidating castling
     switch (m.type) {
         case FORCED_MARCH:
-            newEnPassantSquare = squareBehind(to, toAct);
+            newEnPassantSquare = squareBehind(to, us);
             break;
         case EN_PASSANT: {
-            Square capturedPawnSquare = squareBehind(to, toAct);
-            pieces[capturedPawnSquare] = NO_PIECE;
+            Square capturedPawnSquare = squareBehind(to, us);
+            setPiece(capturedPawnSquare, NO_PIECE);
             break;
         }
         case PROMOTION_QUEEN:
         case PROMOTION_QUEEN_CAPTURE:
-            pieces[to] = toAct == WHITE ? WHITE_QUEEN : BLACK_QUEEN;
+            setPiece(to, us == WHITE ? WHITE_QUEEN : BLACK_QUEEN);
             break;
         case PROMOTION_ROOK:
         case PROMOTION_ROOK_CAPTURE:
-            pieces[to] = toAct == WHITE ? WHITE_ROOK : BLACK_ROOK;
+            setPiece(to, us == WHITE ? WHITE_ROOK : BLACK_ROOK);
             break;
         case PROMOTION_BISHOP:
         case PROMOTION_BISHOP_CAPTURE:
-            pieces[to] = toAct == WHITE ? WHITE_BISHOP : BLACK_BISHOP;
+            setPiece(to, us == WHITE ? WHITE_BISHOP : BLACK_BISHOP);
             break;
         case PROMOTION_KNIGHT:
         case PROMOTION_KNIGHT_CAPTURE:
-            pieces[to] = toAct == WHITE ? WHITE_KNIGHT : BLACK_KNIGHT;
+            setPiece(to, us == WHITE ? WHITE_KNIGHT : BLACK_KNIGHT);
             break;
         case CASTLE_EAST: // h-side or east
-            pieces[to] = NO_PIECE;
-            pieces[from] = NO_PIECE;
-            if (toAct == WHITE) {
-                pieces[CASTLE_EAST_WHITE_ROOK] = WHITE_ROOK;
-                pieces[CASTLE_EAST_WHITE_KING] = WHITE_KING;
+            setPiece(to, NO_PIECE);
+            setPiece(from, NO_PIECE);
+            if (us == WHITE) {
+                setPiece(CASTLE_EAST_WHITE_ROOK, WHITE_ROOK);
+                setPiece(CASTLE_EAST_WHITE_KING, WHITE_KING);
                 whiteKingSquare = CASTLE_EAST_WHITE_KING;
             } else {
-                pieces[CASTLE_EAST_BLACK_ROOK] = BLACK_ROOK;
-                pieces[CASTLE_EAST_BLACK_KING] = BLACK_KING;
+                setPiece(CASTLE_EAST_BLACK_ROOK, BLACK_ROOK);
+                setPiece(CASTLE_EAST_BLACK_KING, BLACK_KING);
                 blackKingSquare = CASTLE_EAST_BLACK_KING;
             }
             break;
         case CASTLE_WEST: // a-side or west
-            pieces[to] = NO_PIECE;
-            pieces[from] = NO_PIECE;
-            if (toAct == WHITE) {
-                pieces[CASTLE_WEST_WHITE_ROOK] = WHITE_ROOK;
-                pieces[CASTLE_WEST_WHITE_KING] = WHITE_KING;
+            setPiece(to, NO_PIECE);
+            setPiece(from, NO_PIECE);
+            if (us == WHITE) {
+                setPiece(CASTLE_WEST_WHITE_ROOK, WHITE_ROOK);
+                setPiece(CASTLE_WEST_WHITE_KING, WHITE_KING);
                 whiteKingSquare = CASTLE_WEST_WHITE_KING;
             } else {
-                pieces[CASTLE_WEST_BLACK_ROOK] = BLACK_ROOK;
-                pieces[CASTLE_WEST_BLACK_KING] = BLACK_KING;
+                setPiece(CASTLE_WEST_BLACK_ROOK, BLACK_ROOK);
+                setPiece(CASTLE_WEST_BLACK_KING, BLACK_KING);
                 blackKingSquare = CASTLE_WEST_BLACK_KING;
             }
             break;
@@ -465,197 +450,539 @@ void GameState::makeMove(Move m) {
             break;
     }
 
+    // setPiece has already accounted for the pieces. Fold in everything else that changed
+    key ^= castleKey(WHITE_EAST_CASTLE, undo.whiteRookEast) ^ castleKey(WHITE_EAST_CASTLE, whiteRookEast);
+    key ^= castleKey(WHITE_WEST_CASTLE, undo.whiteRookWest) ^ castleKey(WHITE_WEST_CASTLE, whiteRookWest);
+    key ^= castleKey(BLACK_EAST_CASTLE, undo.blackRookEast) ^ castleKey(BLACK_EAST_CASTLE, blackRookEast);
+    key ^= castleKey(BLACK_WEST_CASTLE, undo.blackRookWest) ^ castleKey(BLACK_WEST_CASTLE, blackRookWest);
+    key ^= enPassantKey(enPassantSquare) ^ enPassantKey(newEnPassantSquare) ^ zobristKeys.blackToAct;
+
     enPassantSquare = newEnPassantSquare;
+    toAct = enemyColor(us);
+}
+
+void GameState::unmakeMove() {
+    // The side that made the move is the one not to act now
+    if (toAct == WHITE) {
+        unmakeMoveFor<BLACK>();
+    } else {
+        unmakeMoveFor<WHITE>();
+    }
+}
+
+template<Color us>
+void GameState::unmakeMoveFor() {
+    const UndoRecord& undo = undoStack[--undoCount % UNDO_STACK_SIZE];
+    Move m = undo.move;
+    Square from = m.from;
+    Square to = m.to;
+
+    toAct = us;
+    enPassantSquare = undo.enPassantSquare;
+    whiteRookEast = undo.whiteRookEast;
+    whiteRookWest = undo.whiteRookWest;
+    blackRookEast = undo.blackRookEast;
+    blackRookWest = undo.blackRookWest;
+
+    // Castles moved the king and rook to fixed squares; clear those before restoring the originals
+    // since in Chess 960 they may overlap
+    if (m.type == CASTLE_EAST || m.type == CASTLE_WEST) {
+        bool east = m.type == CASTLE_EAST;
+        if (us == WHITE) {
+            setPiece(east ? CASTLE_EAST_WHITE_KING : CASTLE_WEST_WHITE_KING, NO_PIECE);
+            setPiece(east ? CASTLE_EAST_WHITE_ROOK : CASTLE_WEST_WHITE_ROOK, NO_PIECE);
+            setPiece(from, WHITE_KING);
+            setPiece(to, WHITE_ROOK);
+            whiteKingSquare = from;
+        } else {
+            setPiece(east ? CASTLE_EAST_BLACK_KING : CASTLE_WEST_BLACK_KING, NO_PIECE);
+            setPiece(east ? CASTLE_EAST_BLACK_ROOK : CASTLE_WEST_BLACK_ROOK, NO_PIECE);
+            setPiece(from, BLACK_KING);
+            setPiece(to, BLACK_ROOK);
+            blackKingSquare = from;
+        }
+        key = undo.key;
+        return;
+    }
+
+    Piece moved = pieces[to];
+    if (m.isPromotion()) {
+        moved = us == WHITE ? WHITE_PAWN : BLACK_PAWN;
+    } else if (isKing(moved)) {
+        if (us == WHITE) {
+            whiteKingSquare = from;
+        } else {
+            blackKingSquare = from;
+        }
+    }
+
+    setPiece(from, moved);
+    setPiece(to, undo.captured);
+
+    if (m.type == EN_PASSANT) {
+        setPiece(squareBehind(to, us), us == WHITE ? BLACK_PAWN : WHITE_PAWN);
+    }
+
+    // Restoring the pieces brings the key back too, but the saved copy also covers castling and en passant
+    key = undo.key;
+}
+
+void GameState::makeNullMove() {
+    UndoRecord& undo = undoStack[undoCount++ % UNDO_STACK_SIZE];
+    undo.move = Move{};
+    undo.captured = NO_PIECE;
+    undo.enPassantSquare = enPassantSquare;
+    undo.whiteRookEast = whiteRookEast;
+    undo.whiteRookWest = whiteRookWest;
+    undo.blackRookEast = blackRookEast;
+    undo.blackRookWest = blackRookWest;
+    undo.key = key;
+    lastChanges.count = 0;
+
+    key ^= enPassantKey(enPassantSquare) ^ zobristKeys.blackToAct;
+    enPassantSquare = INVALID_SQUARE;
+    toAct = enemyColor(toAct);
+}
+
+void GameState::unmakeNullMove() {
+    const UndoRecord& undo = undoStack[--undoCount % UNDO_STACK_SIZE];
     toAct = enemyColor(toAct);
+    enPassantSquare = undo.enPassantSquare;
+    key = undo.key;
+}
+
+// Returns the pieces of either color that are the only piece between target and a slider of color 'sliders'
+Bitboard GameState::sliderBlockers(const Square target, const Color sliders) const {
+    Bitboard occupancy = occupied();
+    Bitboard blockers = EMPTY_BOARD;
+
+    // Sliders that would attack the target on an empty board are the only ones a single piece can block
+    Bitboard snipers = (rookAttacks(target, EMPTY_BOARD) &
+                        (pieceBoard(PIECE_ROOK, sliders) | pieceBoard(PIECE_QUEEN, sliders))) |
+                       (bishopAttacks(target, EMPTY_BOARD) &
+                        (pieceBoard(PIECE_BISHOP, sliders) | pieceBoard(PIECE_QUEEN, sliders)));
+
+    while (snipers) {
+        Square sniper = popLsb(snipers);
+        Bitboard between = squaresBetween(target, sniper) & occupancy;
+        if (popCount(between) == 1) {
+            blockers |= between;
+        }
+    }
+    return blockers;
+}
+
+// Returns the pieces of the side to act that are the only piece between their king and an enemy slider
+Bitboard GameState::pinnedPieces(const Square kingSquare) const {
+    return sliderBlockers(kingSquare, enemyColor(toAct)) & colorBoard(toAct);
+}
+
+void GameState::generateMoves(MoveList& moves) {
+    moves.clear();
+    generate<ALL>(moves);
+}
+
+void GameState::generateCaptures(MoveList& moves) {
+    moves.clear();
+    generate<CAPTURES>(moves);
 }
 
 std::vector<Move> GameState::generateMoves() {
-    std::vector<Move> moves;
+    MoveList moves;
+    generateMoves(moves);
+    return std::vector<Move>(moves.begin(), moves.end());
+}
+
+std::vector<Move> GameState::generateCaptures() {
+    MoveList moves;
+    generateCaptures(moves);
+    return std::vector<Move>(moves.begin(), moves.end());
+}
 
-    for (Square from = 0; from < 64; from++) {
+bool GameState::hasLegalMove() {
+    MoveList moves;
+    if (toAct == WHITE) {
+        generateFor<WHITE, ALL, true>(moves, ~EMPTY_BOARD);
+    } else {
+        generateFor<BLACK, ALL, true>(moves, ~EMPTY_BOARD);
+    }
+    return !moves.empty();
+}
+
+// Generates only the moves of the piece that would make m, so it's much cheaper than generating everything
+bool GameState::isLegal(Move m) {
+    if (m.from >= 64 || !isFriendly(pieces[m.from], toAct)) {
+        return false;
+    }
+
+    MoveList moves;
+    generate<ALL>(moves, squareBit(m.from));
+    return moves.contains(m);
+}
+
+// Legality is worked out once per position rather than once per move:
+// - In check, generateEvasions takes over (see there)
+// - Pinned pieces may only move along the line between their king and the pinner
+// The king's own moves and en passant (which removes two pieces from a rank) still test each move.
+// The type is known when compiling, so each instantiation only contains the tests it needs. With firstOnly,
+// generation stops after the first piece that has a move. So is the side to act, so which way pawns move and which
+// squares castling uses are constants
+template<Color us, GenerationType type, bool firstOnly>
+void GameState::generateFor(MoveList& moves, Bitboard movers) {
+    constexpr Color them = enemyColor(us);
+    constexpr bool captures = type != QUIETS;
+    constexpr bool quiets = type != CAPTURES;
+
+    Bitboard own = colorBoard(us);
+    Bitboard enemies = colorBoard(them);
+    Bitboard occupancy = own | enemies;
+    Bitboard destinations = type == CAPTURES ? enemies : type == QUIETS ? ~occupancy : ~own;
+
+    Square kingSquare = us == WHITE ? whiteKingSquare : blackKingSquare;
+    Bitboard pinned = EMPTY_BOARD;
+
+    if (kingSquare != INVALID_SQUARE) {
+        Bitboard checkers = attackersTo(kingSquare, occupancy) & enemies;
+        if (checkers) {
+            return generateEvasions<us, type, firstOnly>(moves, movers, kingSquare, checkers);
+        }
+        pinned = pinnedPieces(kingSquare);
+    }
+
+    // Pawns that aren't pinned all move the same way, so they're generated together. Pinned ones are left to the loop
+    Bitboard remaining = own & movers;
+    Bitboard freePawns = remaining & byType[PAWN_INDEX] & ~pinned;
+    if (freePawns) {
+        remaining ^= freePawns;
+        generatePawns<us, type>(moves, freePawns, ~EMPTY_BOARD, enemies, occupancy);
+    }
+
+    while (remaining && !(firstOnly && !moves.empty())) {
+        Square from = popLsb(remaining);
         Piece fromPiece = pieces[from];
 
-        if (pieceColor(fromPiece) != toAct) {
-            continue;
+        Bitboard legal = ~EMPTY_BOARD;
+        if (contains(pinned, from)) {
+            legal = lineThrough(kingSquare, from);
         }
+        Bitboard allowed = legal & destinations;
 
-        switch (fromPiece & MASK_PIECE) {
-            // Pawns: Not many useful precalculations, so just examine each case
+        switch (pieceType(fromPiece)) {
+            // Pawns: pushes depend on empty squares rather than attacks, so examine each case
             case PIECE_PAWN: {
-                Square move, forcedMarch, takeW, takeE;
-                if (toAct == WHITE) {
-                    move = (Square) (from - 8);
-                    forcedMarch = (Square) (move - 8);
-                } else {
-                    move = (Square) (from + 8);
-                    forcedMarch = (Square) (move + 8);
-                }
-                takeW = (Square) (move - 1);
-                takeE = (Square) (move + 1);
+                Square move = us == WHITE ? from - 8 : from + 8;
 
+                // Pushes to the last row count as captures, since they gain material too
                 if (pieces[move] == NO_PIECE) {
-                    // Check losing separately because forced march might eg block a king attack
-                    if (!isLosing(from, move)) {
-                        if (onPromotionRow(move)) { // Add queen and knight promotions, as the rest are useless
-                            moves.emplace_back(from, move, PROMOTION_QUEEN);
-                            moves.emplace_back(from, move, PROMOTION_KNIGHT);
-                        } else {
-                            moves.emplace_back(from, move, MOVE);
-                        }
+                    bool promotion = onPromotionRow(move);
+
+                    // A single push might not block a check that a forced march does, so test each separately
+                    if ((promotion ? captures : quiets) && contains(legal, move)) {
+                        addPawnMove(moves, from, move, false);
                     }
 
                     // Since we can move forward, we check if we can also forced march (OOB check not necessary)
-                    if (onHomeRow(from, toAct) && pieces[forcedMarch] == NO_PIECE && !isLosing(from, forcedMarch)) {
+                    Square forcedMarch = us == WHITE ? move - 8 : move + 8;
+                    if (quiets && onHomeRow(from, us) && pieces[forcedMarch] == NO_PIECE &&
+                        contains(legal, forcedMarch)) {
                         moves.emplace_back(from, forcedMarch, FORCED_MARCH);
                     }
                 }
 
-                // Check the take moves. Horizontal distance will != 1 if the move would wrap
-                if (isEnemy(pieces[takeW], toAct) && horizontalDistance(from, takeW) == 1 &&
-                    !isLosing(from, takeW)) {
-                    if (onPromotionRow(takeW)) { // Add queen and knight promotions, as the rest are useless
-                        moves.emplace_back(from, takeW, PROMOTION_QUEEN_CAPTURE);
-                        moves.emplace_back(from, takeW, PROMOTION_KNIGHT_CAPTURE);
-                    } else {
-                        moves.emplace_back(from, takeW, CAPTURE);
-                    }
+                if (!captures) {
+                    break;
                 }
 
-                if (isEnemy(pieces[takeE], toAct) && horizontalDistance(from, takeE) == 1 &&
-                    !isLosing(from, takeE)) {
-                    if (onPromotionRow(takeE)) { // Add queen and knight promotions, as the rest are useless
-                        moves.emplace_back(from, takeE, PROMOTION_QUEEN_CAPTURE);
-                        moves.emplace_back(from, takeE, PROMOTION_KNIGHT_CAPTURE);
-                    } else {
-                        moves.emplace_back(from, takeE, CAPTURE);
-                    }
+                Bitboard attacks = pawnAttacks(from, us);
+                for (Bitboard targets = attacks & enemies & legal; targets;) {
+                    addPawnMove(moves, from, popLsb(targets), true);
                 }
-                break;
-            } // END PAWN CASE
 
-            // Knights: examine squares from knight data
-            case PIECE_KNIGHT: {
-                Square to;
-                for (Square const* p = knightPtr(from); (to = *p) != INVALID_SQUARE; ++p) {
-                    Piece target = pieces[to];
-
-                    if (!isFriendly(target, toAct) && !isLosing(from, to)) {
-                        if (target == NO_PIECE) {
-                            moves.emplace_back(from, to, MOVE);
-                        } else {
-                            moves.emplace_back(from, to, CAPTURE);
-                        }
-                    }
-                }
-                break;
-            } // END KNIGHT CASE
-
-                // Bishops: loop through direction data from NE to SW
-            case PIECE_BISHOP: {
-                for (int dir = DIAGONAL_START; dir <= DIAGONAL_END; ++dir) {
-                    int inc = dirIncrement(dir);
-                    Square to;
-
-                    for (Square const* p = dirPtr(dir, from); (to = *p) != INVALID_SQUARE; p += inc) {
-                        Piece target = pieces[to];
-
-                        // If it's a piece, the rest are blocked
-                        // Friendly pieces are not valid moves
-                        if (isFriendly(target, toAct)) {
-                            break;
-                        } else if (!isLosing(from, to)) {
-                            if (target == NO_PIECE) {
-                                moves.emplace_back(from, to, MOVE);
-                            } else {
-                                moves.emplace_back(from, to, CAPTURE);
-                                break;
-                            }
-                        }
-                    }
-                }
-                break;
-            } // END BISHOP CASE
-
-            // Rooks: loop through direction data from N to W
-            case PIECE_ROOK: {
-                for (int dir = RANKFILE_START; dir <= RANKFILE_END; ++dir) {
-                    int inc = dirIncrement(dir);
-                    Square to;
-                    for (Square const* p = dirPtr(dir, from); (to = *p) != INVALID_SQUARE; p += inc) {
-                        Piece target = pieces[to];
-
-                        // If it's a piece, the rest are blocked
-                        // Friendly pieces are not valid moves
-                        if (isFriendly(target, toAct)) {
-                            break;
-                        } else if (!isLosing(from, to)) {
-                            if (target == NO_PIECE) {
-                                moves.emplace_back(from, to, MOVE);
-                            } else {
-                                moves.emplace_back(from, to, CAPTURE);
-                                break;
-                            }
-                        }
-                    }
+                // The captured pawn isn't on the destination square, so neither mask describes en passant
+                if (enPassantSquare != INVALID_SQUARE && contains(attacks, enPassantSquare) &&
+                    !isLosing<us>(from, enPassantSquare)) {
+                    moves.emplace_back(from, enPassantSquare, EN_PASSANT);
                 }
                 break;
-            } // END ROOK CASE
-
-                // Queens: loop through direction data from N to SW
-            case PIECE_QUEEN: {
-                for (int dir = ALLDIR_START; dir <= ALLDIR_END; ++dir) {
-                    int inc = dirIncrement(dir);
-                    Square to;
-                    for (Square const* p = dirPtr(dir, from); (to = *p) != INVALID_SQUARE; p += inc) {
-                        Piece target = pieces[to];
-
-                        // If it's a piece, the rest are blocked
-                        // Friendly pieces are not valid moves
-                        if (isFriendly(target, toAct)) {
-                            break;
-                        } else if (!isLosing(from, to)) {
-                            if (target == NO_PIECE) {
-                                moves.emplace_back(from, to, MOVE);
-                            } else {
-                                moves.emplace_back(from, to, CAPTURE);
-                                break;
-                            }
-                        }
-                    }
-                }
-                break;
-            } // END QUEEN CASE
+            } // END PAWN CASE
 
-                // Kings: examine squares from king data, then check castling
+            // Kings: examine attacked squares, then check castling
             case PIECE_KING: {
-                Square to;
-                for (Square const* p = kingPtr(from); (to = *p) != INVALID_SQUARE; ++p) {
-                    Piece target = pieces[to];
-
-                    if (!isFriendly(target, toAct) && !isLosing(from, to)) {
-                        if (target == NO_PIECE) {
-                            moves.emplace_back(from, to, MOVE);
-                        } else {
-                            moves.emplace_back(from, to, CAPTURE);
-                        }
-                    }
+                addKingMoves<us>(moves, from, kingAttacks(from) & destinations);
+
+                // There's no castling out of check
+                if (!quiets || type == EVASIONS) {
+                    break;
                 }
 
-                if(canCastle(true) == CASTLE_SUCCESS) {
-                    moves.emplace_back(from, blackRookWest, CASTLE_WEST);
+                if(canCastle<us>(true) == CASTLE_SUCCESS) {
+                    moves.emplace_back(from, us == WHITE ? whiteRookWest : blackRookWest, CASTLE_WEST);
                 }
 
-                if(canCastle(false) == CASTLE_SUCCESS) {
-                    moves.emplace_back(from, blackRookEast, CASTLE_EAST);
+                if(canCastle<us>(false) == CASTLE_SUCCESS) {
+                    moves.emplace_back(from, us == WHITE ? whiteRookEast : blackRookEast, CASTLE_EAST);
                 }
                 break;
             } // END KING CASE
 
-            default:
+            // Knights, bishops, rooks and queens can move to any attacked square without a friendly piece
+            default: {
+                for (Bitboard targets = pieceAttacks(fromPiece, from, occupancy) & allowed; targets;) {
+                    Square to = popLsb(targets);
+                    moves.emplace_back(from, to, contains(enemies, to) ? CAPTURE : MOVE);
+                }
                 break;
+            }
+        }
+    }
+}
+
+// Adds the king's moves to whichever targets the enemy doesn't attack.
+// Building the attack map costs about as much as testing five squares one at a time (see bench)
+template<Color us>
+void GameState::addKingMoves(MoveList& moves, const Square from, Bitboard targets) {
+    constexpr Color them = enemyColor(us);
+    Bitboard enemies = colorBoard(them);
+    bool useMap = popCount(targets) > 4 || (attacksValid & (1u << colorIndex(them)));
+    if (useMap) {
+        targets &= ~attackedBy(them);
+    }
+    while (targets) {
+        Square to = popLsb(targets);
+        if (useMap || !(attackersTo(to, occupied()) & enemies)) {
+            moves.emplace_back(from, to, contains(enemies, to) ? CAPTURE : MOVE);
+        }
+    }
+}
+
+// Shifting a set of squares one row forward for us moves each pawn in it one square forward
+template<Color us>
+static constexpr Bitboard forward(Bitboard b) {
+    return us == WHITE ? b >> 8u : b << 8u;
+}
+
+// Only three things get out of check: moving the king, capturing the checker or stepping between it and the king,
+// and only the king can do anything about two checkers. So rather than masking every piece's moves, look up the
+// few pieces that reach the checker or the squares between. A pinned piece can never help: it can't leave the line
+// of its pin, which only meets the line of the check at the king
+template<Color us, GenerationType type, bool firstOnly>
+void GameState::generateEvasions(MoveList& moves, Bitboard movers, const Square kingSquare, const Bitboard checkers) {
+    constexpr Color them = enemyColor(us);
+    constexpr bool captures = type != QUIETS;
+    constexpr bool quiets = type != CAPTURES;
+    constexpr int step = us == WHITE ? -8 : 8;
+    constexpr Bitboard promotionRow = us == WHITE ? RANK_8 : RANK_1;
+    constexpr Bitboard marchRow = us == WHITE ? RANK_1 >> 16u : RANK_8 << 16u;
+    Bitboard own = colorBoard(us);
+    Bitboard occupancy = occupied();
+    Bitboard destinations = type == CAPTURES ? colorBoard(them) : type == QUIETS ? ~occupancy : ~own;
+
+    // Sliders checking the king still attack the squares behind it once it steps away
+    if (contains(movers, kingSquare)) {
+        Bitboard behindKing = EMPTY_BOARD;
+        Bitboard sliders = byType[BISHOP_INDEX] | byType[ROOK_INDEX] | byType[QUEEN_INDEX];
+        for (Bitboard checking = checkers & sliders; checking;) {
+            behindKing |= rayFrom(getDirection(popLsb(checking), kingSquare), kingSquare);
+        }
+        addKingMoves<us>(moves, kingSquare, kingAttacks(kingSquare) & destinations & ~behindKing);
+    }
+
+    if (popCount(checkers) > 1 || (firstOnly && !moves.empty())) {
+        return;
+    }
+
+    Square checker = lsb(checkers);
+    Bitboard blocks = squaresBetween(kingSquare, checker);
+    Bitboard defenders = own & movers & ~squareBit(kingSquare) & ~pinnedPieces(kingSquare);
+    Bitboard pawns = defenders & byType[PAWN_INDEX];
+
+    if (captures) {
+        for (Bitboard capturers = attackersTo(checker, occupancy) & defenders; capturers;) {
+            Square from = popLsb(capturers);
+            if (contains(pawns, from)) {
+                addPawnMove(moves, from, checker, true);
+            } else {
+                moves.emplace_back(from, checker, CAPTURE);
+            }
+        }
+    }
+
+    // The squares between are empty, so pawns reach them by pushing rather than capturing
+    if (quiets) {
+        for (Bitboard targets = blocks; targets;) {
+            Square to = popLsb(targets);
+            for (Bitboard blockers = attackersTo(to, occupancy) & defenders & ~pawns; blockers;) {
+                moves.emplace_back(popLsb(blockers), to, MOVE);
+            }
+        }
+    }
+
+    // Pushes to the last row count as captures, as in generatePawns
+    Bitboard pushes = forward<us>(pawns) & ~occupancy;
+    Bitboard blockingPushes = pushes & blocks & ((captures ? promotionRow : EMPTY_BOARD) |
+                                                 (quiets ? ~promotionRow : EMPTY_BOARD));
+    for (Bitboard targets = blockingPushes; targets;) {
+        Square to = popLsb(targets);
+        addPawnMove(moves, to - step, to, false);
+    }
+    if (quiets) {
+        for (Bitboard targets = forward<us>(pushes & marchRow) & ~occupancy & blocks; targets;) {
+            Square to = popLsb(targets);
+            moves.emplace_back(to - 2 * step, to, FORCED_MARCH);
+        }
+    }
+
+    // En passant helps if the pawn that just marched is the checker, or if the capturing pawn lands in between
+    if (captures && enPassantSquare != INVALID_SQUARE &&
+        (squareBehind(enPassantSquare, us) == checker || contains(blocks, enPassantSquare))) {
+        Bitboard takers = pawnAttacks(enPassantSquare, them) & pieceBoard(PIECE_PAWN, us) & movers;
+        while (takers) {
+            Square from = popLsb(takers);
+            if (!isLosing<us>(from, enPassantSquare)) {
+                moves.emplace_back(from, enPassantSquare, EN_PASSANT);
+            }
         }
     }
-    return moves;
+}
+
+// Every pawn's pushes or captures in one direction are a single shift of the set. Each destination's pawn is found
+// by stepping back by the shift. The empty square behind a forced march must be in the single pushes first, and the
+// captured pawn of en passant can uncover an attack on the king, so each en passant is still tested on its own
+template<Color us, GenerationType type>
+void GameState::generatePawns(MoveList& moves, Bitboard pawns, Bitboard legal, Bitboard enemies,
+                              Bitboard occupancy) {
+    constexpr bool captures = type != QUIETS;
+    constexpr bool quiets = type != CAPTURES;
+    constexpr int step = us == WHITE ? -8 : 8;
+    constexpr Bitboard promotionRow = us == WHITE ? RANK_8 : RANK_1;
+    constexpr Bitboard marchRow = us == WHITE ? RANK_1 >> 16u : RANK_8 << 16u; // Where single pushes from home land
+
+    Bitboard pushes = forward<us>(pawns) & ~occupancy;
+    if (captures) {
+        for (Bitboard targets = pushes & legal & promotionRow; targets;) {
+            Square to = popLsb(targets);
+            addPawnMove(moves, to - step, to, false);
+        }
+    }
+    if (quiets) {
+        for (Bitboard targets = pushes & legal & ~promotionRow; targets;) {
+            Square to = popLsb(targets);
+            moves.emplace_back(to - step, to, MOVE);
+        }
+        for (Bitboard targets = forward<us>(pushes & marchRow) & ~occupancy & legal; targets;) {
+            Square to = popLsb(targets);
+            moves.emplace_back(to - 2 * step, to, FORCED_MARCH);
+        }
+    }
+    if (!captures) {
+        return;
+    }
+
+    // Towards the a file and towards the h file
+    Bitboard west = forward<us>(pawns & ~FILE_A) >> 1u;
+    Bitboard east = forward<us>(pawns & ~FILE_H) << 1u;
+    for (Bitboard targets = west & enemies & legal; targets;) {
+        Square to = popLsb(targets);
+        addPawnMove(moves, to - step + 1, to, true);
+    }
+    for (Bitboard targets = east & enemies & legal; targets;) {
+        Square to = popLsb(targets);
+        addPawnMove(moves, to - step - 1, to, true);
+    }
+
+    if (enPassantSquare != INVALID_SQUARE) {
+        for (Bitboard takers = pawnAttacks(enPassantSquare, enemyColor(us)) & pawns; takers;) {
+            Square from = popLsb(takers);
+            if (!isLosing<us>(from, enPassantSquare)) {
+                moves.emplace_back(from, enPassantSquare, EN_PASSANT);
+            }
+        }
+    }
+}
+
+template<GenerationType type>
+void GameState::generate(MoveList& moves, Bitboard movers) {
+    if (toAct == WHITE) {
+        generateFor<WHITE, type, false>(moves, movers);
+    } else {
+        generateFor<BLACK, type, false>(moves, movers);
+    }
+}
+
+template void GameState::generate<CAPTURES>(MoveList& moves, Bitboard movers);
+template void GameState::generate<QUIETS>(MoveList& moves, Bitboard movers);
+template void GameState::generate<EVASIONS>(MoveList& moves, Bitboard movers);
+template void GameState::generate<ALL>(MoveList& moves, Bitboard movers);
+
+// Plays out the exchange with the swap algorithm: gains[d] is what the side making the dth capture wins if the
+// exchange ended there, and working back from the last capture, each side takes the better of stopping or capturing
+int GameState::staticExchange(Move m) const {
+    if (m.type == CASTLE_EAST || m.type == CASTLE_WEST) {
+        return 0;
+    }
+
+    Square from = m.from;
+    Square to = m.to;
+    Color side = pieceColor(pieces[from]);
+    Bitboard occupancy = occupied() ^ squareBit(from);
+
+    int gains[32];
+    int nextVictim = pieceValue(pieces[from]);
+    gains[0] = pieceValue(pieces[to]);
+
+    if (m.type == EN_PASSANT) {
+        gains[0] = PIECE_VALUES[PAWN_INDEX];
+        occupancy ^= squareBit(squareBehind(to, side));
+    } else if (m.isPromotion()) {
+        // Capturing promotions come 4 after their quiet counterparts
+        MoveType promotion = m.isCapture() ? (MoveType) (m.type - 4) : m.type;
+        int promotedValue = promotion == PROMOTION_QUEEN ? PIECE_VALUES[QUEEN_INDEX]
+                          : promotion == PROMOTION_ROOK ? PIECE_VALUES[ROOK_INDEX]
+                          : promotion == PROMOTION_BISHOP ? PIECE_VALUES[BISHOP_INDEX]
+                          : PIECE_VALUES[KNIGHT_INDEX];
+        gains[0] += promotedValue - PIECE_VALUES[PAWN_INDEX];
+        nextVictim = promotedValue;
+    }
+
+    Bitboard rooksQueens = byType[ROOK_INDEX] | byType[QUEEN_INDEX];
+    Bitboard bishopsQueens = byType[BISHOP_INDEX] | byType[QUEEN_INDEX];
+    Bitboard attackers = attackersTo(to, occupancy) & occupancy;
+    int depth = 0;
+
+    while (true) {
+        side = enemyColor(side);
+        Bitboard ownAttackers = attackers & colorBoard(side);
+        if (!ownAttackers) {
+            break;
+        }
+
+        // Recapture with the least valuable piece
+        int type = PAWN_INDEX;
+        while (!(ownAttackers & byType[type])) {
+            type++;
+        }
+        Square attacker = lsb(ownAttackers & byType[type]);
+
+        // The king can only recapture if nothing can take it back
+        if (type == KING_INDEX && (attackers & colorBoard(enemyColor(side)))) {
+            break;
+        }
+
+        depth++;
+        gains[depth] = nextVictim - gains[depth - 1];
+        nextVictim = PIECE_VALUES[type];
+
+        // Moving the attacker off its square may uncover a slider behind it
+        occupancy ^= squareBit(attacker);
+        attackers |= (rookAttacks(to, occupancy) & rooksQueens) | (bishopAttacks(to, occupancy) & bishopsQueens);
+        attackers &= occupancy;
+    }
+
+    while (depth > 0) {
+        gains[depth - 1] = -std::max(-gains[depth - 1], gains[depth]);
+        depth--;
+    }
+    return gains[0];
 }
 
 bool GameState::currentPlayerInCheck() const {
@@ -666,12 +993,97 @@ bool GameState::currentPlayerInCheck() const {
     }
 }
 
+// A piece checks from the squares the same piece on the enemy king's square would attack
+const GameState::CheckInfo& GameState::checksBy(const Color us) const {
+    int side = colorIndex(us);
+    CheckInfo& info = checkInfo[side];
+    if (!(checksValid & (1u << side))) {
+        Square king = getKingLocation(enemyColor(us));
+        Bitboard occupancy = occupied();
+        info.squares[PAWN_INDEX] = pawnAttacks(king, enemyColor(us));
+        info.squares[KNIGHT_INDEX] = knightAttacks(king);
+        info.squares[BISHOP_INDEX] = bishopAttacks(king, occupancy);
+        info.squares[ROOK_INDEX] = rookAttacks(king, occupancy);
+        info.squares[QUEEN_INDEX] = info.squares[BISHOP_INDEX] | info.squares[ROOK_INDEX];
+        info.squares[KING_INDEX] = EMPTY_BOARD;
+        info.discoverers = sliderBlockers(king, us) & colorBoard(us);
+        checksValid |= 1u << side;
+    }
+    return info;
+}
+
+bool GameState::givesCheck(const Move m) const {
+    Square king = getKingLocation(enemyColor(toAct));
+    if (king == INVALID_SQUARE) {
+        return false;
+    }
+
+    const CheckInfo& info = checksBy(toAct);
+    Square from = m.from, to = m.to;
 
+    // Uncovered by leaving the line between the king and one of our sliders
+    if (contains(info.discoverers, from) && !contains(lineThrough(king, from), to)) {
+        return true;
+    }
 
+    Bitboard occupancy = occupied();
+    switch (m.type) {
+        case MOVE:
+        case CAPTURE:
+        case FORCED_MARCH:
+            return contains(info.squares[typeIndex(pieces[from])], to);
+
+        // The captured pawn leaves a square too, which may uncover a check along a rank or diagonal
+        case EN_PASSANT: {
+            if (contains(info.squares[PAWN_INDEX], to)) {
+                return true;
+            }
+            Bitboard after = (occupancy ^ squareBit(from) ^ squareBit(squareBehind(to, toAct))) | squareBit(to);
+            return (rookAttacks(king, after) & (pieceBoard(PIECE_ROOK, toAct) | pieceBoard(PIECE_QUEEN, toAct))) |
+                   (bishopAttacks(king, after) & (pieceBoard(PIECE_BISHOP, toAct) | pieceBoard(PIECE_QUEEN, toAct)));
+        }
+
+        // The promoted piece attacks through the square the pawn left
+        case PROMOTION_QUEEN:
+        case PROMOTION_QUEEN_CAPTURE:
+            return contains(queenAttacks(to, occupancy ^ squareBit(from)), king);
+        case PROMOTION_ROOK:
+        case PROMOTION_ROOK_CAPTURE:
+            return contains(rookAttacks(to, occupancy ^ squareBit(from)), king);
+        case PROMOTION_BISHOP:
+        case PROMOTION_BISHOP_CAPTURE:
+            return contains(bishopAttacks(to, occupancy ^ squareBit(from)), king);
+        case PROMOTION_KNIGHT:
+        case PROMOTION_KNIGHT_CAPTURE:
+            return contains(info.squares[KNIGHT_INDEX], to);
+
+        // Nothing can stand behind a piece on the back row except along it, so the only new checks come from the
+        // rook on its new square or from rooks and queens seeing along the row through the squares left empty
+        case CASTLE_EAST:
+        case CASTLE_WEST: {
+            bool east = m.type == CASTLE_EAST;
+            Square rookTo = toAct == WHITE ? (east ? CASTLE_EAST_WHITE_ROOK : CASTLE_WEST_WHITE_ROOK)
+                                           : (east ? CASTLE_EAST_BLACK_ROOK : CASTLE_WEST_BLACK_ROOK);
+            Square kingTo = toAct == WHITE ? (east ? CASTLE_EAST_WHITE_KING : CASTLE_WEST_WHITE_KING)
+                                           : (east ? CASTLE_EAST_BLACK_KING : CASTLE_WEST_BLACK_KING);
+            Bitboard after = (occupancy ^ squareBit(from) ^ squareBit(to)) | squareBit(rookTo) | squareBit(kingTo);
+            Bitboard straight = (pieceBoard(PIECE_ROOK, toAct) ^ squareBit(to)) | squareBit(rookTo) |
+                                pieceBoard(PIECE_QUEEN, toAct);
+            return rookAttacks(king, after) & straight;
+        }
+
+        default:
+            return false;
+    }
+}
+
+
+
+template<Color us>
 GameState::CastleResult GameState::canCastle(bool west) {
     Square kingSquare, rookSquare, targetSquare;
 
-    if (toAct == WHITE) {
+    if (us == WHITE) {
         rookSquare = west ? whiteRookWest : whiteRookEast;
         targetSquare = west ? CASTLE_WEST_WHITE_KING : CASTLE_EAST_WHITE_KING;
         kingSquare = whiteKingSquare;
@@ -686,15 +1098,12 @@ GameState::CastleResult GameState::canCastle(bool west) {
     }
 
     // There must be no pieces between the king and the rook square
-    int rookInc = signOf(rookSquare - kingSquare);
-    for (auto s = (Square) (rookInc + kingSquare); s != rookSquare; s += rookInc) {
-        if (pieces[s] != NO_PIECE) {
-            return CASTLE_ERR_BLOCKED;
-        }
+    if (isBlocked(kingSquare, rookSquare)) {
+        return CASTLE_ERR_BLOCKED;
     }
 
     // The king cannot be in check or move through a square under threat
-    Color enemy = enemyColor(toAct);
+    Color enemy = enemyColor(us);
     if (isThreatenedBy(kingSquare, enemy)) {
         return CASTLE_ERR_KING_CHECK;
     }
@@ -711,7 +1120,7 @@ GameState::CastleResult GameState::canCastle(bool west) {
 }
 
 void GameState::validateCastle(bool west) {
-    switch(canCastle(west)) {
+    switch(toAct == WHITE ? canCastle<WHITE>(west) : canCastle<BLACK>(west)) {
         case CASTLE_SUCCESS:break;
         case CASTLE_ERR_MOVED:
             throw Error("Cannot castle: either the king or rook involved have moved");
@@ -734,4 +1143,17 @@ GameState::GameState()
         NO_PIECE, NO_PIECE, NO_PIECE, NO_PIECE, NO_PIECE, NO_PIECE, NO_PIECE, NO_PIECE,
         WHITE_PAWN, WHITE_PAWN, WHITE_PAWN, WHITE_PAWN, WHITE_PAWN, WHITE_PAWN, WHITE_PAWN, WHITE_PAWN,
         WHITE_ROOK, WHITE_KNIGHT, WHITE_BISHOP, WHITE_QUEEN, WHITE_KING, WHITE_BISHOP, WHITE_KNIGHT, WHITE_ROOK
-} {}
+} {
+    initBitboards();
+
+    for (Square s = 0; s < 64; s++) {
+        if (pieces[s] != NO_PIECE) {
+            byType[typeIndex(pieces[s])] |= squareBit(s);
+            byColor[colorIndex(pieceColor(pieces[s]))] |= squareBit(s);
+        }
+    }
+
+    key = computeKey();
+    pieceSquareScore = computePieceSquareScore();
+    phase = computePhase();
+}
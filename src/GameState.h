@@ -6,60 +6,275 @@
 #include "piece.h"
 #include "Error.h"
 #include "Move.h"
+#include "MoveList.h"
+#include "bitboard.h"
 #include "logistics.h"
+#include "zobrist.h"
+#include "pst.h"
+
+namespace CA3 {
+    // Kinds of moves to generate. Promotions count as captures, since they gain material too
+    enum GenerationType : uint8_t {
+        CAPTURES, // Captures, en passant and promotions
+        QUIETS, // Everything else
+        EVASIONS, // Every move, for a side in check
+        ALL
+    };
+}
 
 class GameState {
 public:
+    // Lets gs[s] be assigned to like a Piece while keeping the bitboards in sync with the pieces array
+    class SquareRef {
+    public:
+        SquareRef(GameState& gs, CA3::Square s) : gs{gs}, s{s} {}
+
+        operator CA3::Piece() const { return gs.pieces[s]; }
+
+        SquareRef& operator = (CA3::Piece p) {
+            gs.setPiece(s, p);
+            return *this;
+        }
+
+    private:
+        GameState& gs;
+        CA3::Square s;
+    };
+
     GameState();
 
     CA3::Piece operator [] (CA3::Square i) const { return pieces[i]; }
-    CA3::Piece& operator [] (CA3::Square i) { return pieces[i]; }
+    SquareRef operator [] (CA3::Square i) { return SquareRef{*this, i}; }
+
+    // Places p on s, replacing whatever was there. NO_PIECE empties the square
+    void setPiece(CA3::Square s, CA3::Piece p);
 
     void makeEmpty();
 
+    // Sets of squares occupied by a piece type of a color, by a color, or by anything
+    CA3::Bitboard pieceBoard(CA3::PieceCharacteristic type, CA3::Color c) const {
+        return byType[CA3::typeIndex(type)] & byColor[CA3::colorIndex(c)];
+    }
+    CA3::Bitboard colorBoard(CA3::Color c) const { return byColor[CA3::colorIndex(c)]; }
+    CA3::Bitboard occupied() const { return byColor[0] | byColor[1]; }
+
+    // Zobrist key of the position, kept up to date by every change to the GameState
+    uint64_t getKey() const { return key; }
+
+    // Builds the key from scratch. It should always equal getKey()
+    uint64_t computeKey() const;
+
+    // The sum of the pieces' piece-square scores and phase weights (see pst.h), kept up to date like the key
+    CA3::TaperedScore getPieceSquareScore() const { return pieceSquareScore; }
+    int getPhase() const { return phase; }
+
+    // Build them from scratch. They should always equal the kept values
+    CA3::TaperedScore computePieceSquareScore() const;
+    int computePhase() const;
+
+    // A square whose piece changed, eg for updating an evaluation that depends on where the pieces are
+    struct PieceChange {
+        CA3::Square square;
+        CA3::Piece removed, added; // Either may be NO_PIECE
+    };
+
+    // The changes made by the last makeMove or makeNullMove, in order. A move makes at most four (castling).
+    // Anything else that places pieces, including unmakeMove, leaves them meaningless
+    struct MoveChanges {
+        PieceChange changes[4];
+        uint8_t count;
+    };
+
+    const MoveChanges& getLastChanges() const { return lastChanges; }
+
+    // The squares each color attacks. Built on the first call after the position changes and kept until the next
+    // change, so asking about many squares costs one build. Doesn't see through pieces, eg the king's own square
+    CA3::Bitboard attackedBy(CA3::Color c) const;
+
+    // Returns the pieces of both colors that attack square s if the occupied squares were 'occupancy'
+    CA3::Bitboard attackersTo(CA3::Square s, CA3::Bitboard occupancy) const;
+
     bool isThreatenedBy(CA3::Square toCheck, CA3::Color enemyColor) const;
     bool isThreatenedBySquare(CA3::Square victim, CA3::Square attackingSquare) const;
     bool currentPlayerInCheck() const;
 
+    // Whether making m, a valid move for the side to act, would check the enemy king, without making it. Looks up
+    // the squares each piece type would check from and the pieces that would uncover a check by moving, which are
+    // found on the first call and kept until the position changes
+    bool givesCheck(Move m) const;
+
     // Given a from and to square describing a move, returns corresponding Move object.
     // If the move is valid, the returned Move will be ready to pass to makeMove UNLESS
     // it involves a pawn promotion, in which case the Move's type will be NEED_PROMOTION.
     // If the move is not valid, an Error will be thrown that contains a descriptive error message.
     Move validateMove(CA3::Square from, CA3::Square to);
 
-    // Generate all valid moves in the GameState. Promotion moves will include queen and knight options
-    // Will be empty if the game is over (stalemate or checkmate)
+    // Generate all valid moves in the GameState into moves, replacing what was there. Promotions generate one move
+    // per promotion piece. Will be empty if the game is over (stalemate or checkmate)
+    void generateMoves(MoveList& moves);
+
+    // Generate the valid moves that capture or promote. Used to resolve exchanges at the end of a search
+    void generateCaptures(MoveList& moves);
+
+    // The same, copied into a vector for convenience where speed doesn't matter
     std::vector<Move> generateMoves();
+    std::vector<Move> generateCaptures();
+
+    // Appends the valid moves of one kind (see GenerationType) made by the pieces on movers. Generating
+    // CAPTURES then QUIETS gives the same moves as ALL, so a search can stop after the captures if one cuts off
+    template<CA3::GenerationType type>
+    void generate(MoveList& moves, CA3::Bitboard movers = ~CA3::EMPTY_BOARD);
+
+    // Whether the side to act has any valid move, stopping at the first piece found with one. Cheaper than
+    // generating every move when only checkmate or stalemate matters
+    bool hasLegalMove();
+
+    // Whether m is one of the valid moves here, eg for a move remembered from another position
+    bool isLegal(Move m);
+
+    // Static exchange evaluation: the material the side to act gains (or loses, if negative) by making the
+    // capture m and then trading off every piece that attacks the square, least valuable first, while each
+    // side may stop capturing whenever continuing would lose material. Pins and checks are ignored.
+    // Moves that don't capture score 0, or the promotion's gain
+    int staticExchange(Move m) const;
 
     // Should only be called with valid moves! Check them with validateMove
     // or generate them with generatePossibleMoves.
     // Returns true if the GameState needs to promote a pawn
     void makeMove(Move m);
 
+    // Takes back the last move made with makeMove, restoring the GameState exactly.
+    // Undo records are kept in a ring of UNDO_STACK_SIZE entries, so at most that many moves can be taken back
+    void unmakeMove();
+
+    // Passes the turn: only the side to act and the en passant square change. Not a legal move, but the search
+    // uses it to see whether a position is good enough that even moving twice in a row wouldn't help the opponent.
+    // Must not be called in check. Take it back with unmakeNullMove, in order with any other moves
+    void makeNullMove();
+    void unmakeNullMove();
+
+    static constexpr unsigned UNDO_STACK_SIZE = 256;
+
     CA3::Color getToAct() const { return toAct; };
+    CA3::Square getKingLocation(CA3::Color c) const { return c == CA3::WHITE ? whiteKingSquare : blackKingSquare; };
+    CA3::Square getEnPassantSquare() const { return enPassantSquare; };
+    CA3::Square getWhiteRookEastLocation() const { return whiteRookEast; };
+    CA3::Square getWhiteRookWestLocation() const { return whiteRookWest; };
+    CA3::Square getBlackRookEastLocation() const { return blackRookEast; };
+    CA3::Square getBlackRookWestLocation() const { return blackRookWest; };
 
     // Mostly for testing
-    void setToAct(CA3::Color _toAct) { toAct = _toAct; };
-    void setWhiteKingLocation(CA3::Square location) { whiteKingSquare = location; };
-    void setWhiteRookEastLocation(CA3::Square location) { whiteRookEast = location; };
-    void setWhiteRookWestLocation(CA3::Square location) { whiteRookWest = location; };
-    void setBlackKingLocation(CA3::Square location) { blackKingSquare = location; };
-    void setBlackRookEastLocation(CA3::Square location) { blackRookEast = location; };
-    void setBlackRookWestLocation(CA3::Square location) { blackRookWest = location; };
+    void setToAct(CA3::Color _toAct) {
+        key ^= _toAct == toAct ? 0 : CA3::zobristKeys.blackToAct;
+        toAct = _toAct;
+    };
+    void setEnPassantSquare(CA3::Square square) {
+        key ^= CA3::enPassantKey(enPassantSquare) ^ CA3::enPassantKey(square);
+        enPassantSquare = square;
+    };
+    void setWhiteKingLocation(CA3::Square location) {
+        whiteKingSquare = location;
+        checksValid = 0;
+    };
+    void setWhiteRookEastLocation(CA3::Square location) { setCastle(CA3::WHITE_EAST_CASTLE, whiteRookEast, location); };
+    void setWhiteRookWestLocation(CA3::Square location) { setCastle(CA3::WHITE_WEST_CASTLE, whiteRookWest, location); };
+    void setBlackKingLocation(CA3::Square location) {
+        blackKingSquare = location;
+        checksValid = 0;
+    };
+    void setBlackRookEastLocation(CA3::Square location) { setCastle(CA3::BLACK_EAST_CASTLE, blackRookEast, location); };
+    void setBlackRookWestLocation(CA3::Square location) { setCastle(CA3::BLACK_WEST_CASTLE, blackRookWest, location); };
 
 private:
+    // Everything makeMove overwrites that can't be recovered from the Move itself
+    struct UndoRecord {
+        Move move;
+        CA3::Piece captured;
+        CA3::Square enPassantSquare;
+        CA3::Square whiteRookEast, whiteRookWest, blackRookEast, blackRookWest;
+        uint64_t key;
+    };
+
     CA3::Piece pieces[64];
+    CA3::Bitboard byType[6]{}; // Indexed by typeIndex
+    CA3::Bitboard byColor[2]{}; // Indexed by colorIndex
     CA3::Color toAct{CA3::WHITE};
     CA3::Square blackKingSquare{4}, whiteKingSquare{60}, enPassantSquare{CA3::INVALID_SQUARE};
     CA3::Square blackRookEast{7}, blackRookWest{0}, whiteRookEast{63}, whiteRookWest{56};
+    uint64_t key{0};
+    CA3::TaperedScore pieceSquareScore{0, 0};
+    int phase{0};
+    MoveChanges lastChanges{};
+    mutable CA3::Bitboard attacks[2]{}; // Indexed by colorIndex. Only valid for the colors set in attacksValid
+    mutable uint8_t attacksValid{0};
+
+    // What givesCheck needs to know about one color's checks on the enemy king
+    struct CheckInfo {
+        CA3::Bitboard squares[6]; // Indexed by typeIndex: where a piece of that type would check from
+        CA3::Bitboard discoverers; // Pieces that uncover a check by leaving their line to the king
+    };
+    mutable CheckInfo checkInfo[2]; // Indexed by colorIndex of the checking side. Only valid for checksValid colors
+    mutable uint8_t checksValid{0};
+
+    UndoRecord undoStack[UNDO_STACK_SIZE];
+    unsigned undoCount{0};
+
+    void setCastle(int slot, CA3::Square& rook, CA3::Square location) {
+        key ^= CA3::castleKey(slot, rook) ^ CA3::castleKey(slot, location);
+        rook = location;
+    }
 
-    CA3::Square nearestOccupiedInDir(CA3::Square from, CA3::Direction dir) const;
-    bool isBlocked(CA3::Square from, CA3::Square to, CA3::Direction dir) const;
-    bool isLosing(CA3::Square from, CA3::Square to);
+    bool isBlocked(CA3::Square from, CA3::Square to) const;
+    template<CA3::Color us>
+    bool isLosing(CA3::Square from, CA3::Square to) const;
+    CA3::Bitboard sliderBlockers(CA3::Square target, CA3::Color sliders) const;
+    CA3::Bitboard pinnedPieces(CA3::Square kingSquare) const;
+    const CheckInfo& checksBy(CA3::Color us) const;
+    template<CA3::Color us, CA3::GenerationType type, bool firstOnly>
+    void generateFor(MoveList& moves, CA3::Bitboard movers);
+    template<CA3::Color us, CA3::GenerationType type, bool firstOnly>
+    void generateEvasions(MoveList& moves, CA3::Bitboard movers, CA3::Square kingSquare, CA3::Bitboard checkers);
+    template<CA3::Color us>
+    void addKingMoves(MoveList& moves, CA3::Square from, CA3::Bitboard targets);
+    template<CA3::Color us, CA3::GenerationType type>
+    void generatePawns(MoveList& moves, CA3::Bitboard pawns, CA3::Bitboard legal, CA3::Bitboard enemies,
+                       CA3::Bitboard occupancy);
+    template<CA3::Color us>
+    void makeMoveFor(Move m);
+    template<CA3::Color us>
+    void unmakeMoveFor();
 
     enum CastleResult : uint8_t;
+    template<CA3::Color us>
     CastleResult canCastle(bool west);
     void validateCastle(bool west);
 };
 
+inline void GameState::setPiece(CA3::Square s, CA3::Piece p) {
+    CA3::Bitboard bit = CA3::squareBit(s);
+    CA3::Piece old = pieces[s];
+    attacksValid = 0;
+    checksValid = 0;
+
+    if (old != CA3::NO_PIECE) {
+        byType[CA3::typeIndex(old)] ^= bit;
+        byColor[CA3::colorIndex(CA3::pieceColor(old))] ^= bit;
+        pieceSquareScore = pieceSquareScore - CA3::pieceSquareScore(old, s);
+        phase -= CA3::phaseWeight(old);
+    }
+
+    key ^= CA3::pieceKey(old, s) ^ CA3::pieceKey(p, s);
+    pieces[s] = p;
+    if (lastChanges.count < 4) { // Only placing pieces outside makeMove makes more, and those aren't used
+        lastChanges.changes[lastChanges.count++] = {s, old, p};
+    }
+
+    if (p != CA3::NO_PIECE) {
+        byType[CA3::typeIndex(p)] |= bit;
+        byColor[CA3::colorIndex(CA3::pieceColor(p))] |= bit;
+        pieceSquareScore = pieceSquareScore + CA3::pieceSquareScore(p, s);
+        phase += CA3::phaseWeight(p);
+    }
+}
+
 #endif //CHESSAMATEUR3_GAMESTATE_H
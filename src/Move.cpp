@@ -7,11 +7,11 @@ Move::Move(Square _from, Square _to, MoveType _type)
 
 }
 
-bool Move::isCapture() {
+bool Move::isCapture() const {
     return type == CAPTURE || type == EN_PASSANT || type >= PROMOTION_QUEEN_CAPTURE;
 }
 
-bool Move::isPromotion() {
+bool Move::isPromotion() const {
     return type >= PROMOTION_QUEEN;
 }
 
@@ -14,8 +14,17 @@ struct Move {
 
     Move(CA3::Square from, CA3::Square to, MoveType type);
 
-    bool isCapture();
-    bool isPromotion();
+    bool isCapture() const;
+    bool isPromotion() const;
+
+    bool operator == (const Move& other) const { return from == other.from && to == other.to && type == other.type; }
+    bool operator != (const Move& other) const { return !(*this == other); }
+
+    // Packs the move into 16 bits: 6 for from, 6 for to and 4 for the type. A default Move packs to 0
+    uint16_t pack() const { return (uint16_t) (from | to << 6u | type << 12u); }
+    static Move unpack(uint16_t packed) {
+        return Move{(CA3::Square) (packed & 63u), (CA3::Square) ((packed >> 6u) & 63u), (MoveType) (packed >> 12u)};
+    }
 
     CA3::Square from{}, to{};
     MoveType type{};
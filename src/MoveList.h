@@ -0,0 +1,63 @@
+#ifndef CHESSAMATEUR3_MOVELIST_H
+#define CHESSAMATEUR3_MOVELIST_H
+
+#include <stddef.h>
+#include "Move.h"
+
+// A list of moves with room for any position's legal moves (the most known is 218), so generating into one
+// never allocates. Lives wherever it's declared, usually on the stack or in a search node, and is reused by
+// clearing it
+
+class MoveList {
+public:
+    static constexpr size_t CAPACITY = 256;
+
+    // There is no bounds check: move generation can't overflow the list
+    void push_back(Move m) { moves[count++] = m; }
+    void emplace_back(CA3::Square from, CA3::Square to, MoveType type) { moves[count++] = Move{from, to, type}; }
+    void clear() { count = 0; }
+
+    size_t size() const { return count; }
+    bool empty() const { return count == 0; }
+
+    Move& operator [] (size_t i) { return moves[i]; }
+    const Move& operator [] (size_t i) const { return moves[i]; }
+
+    Move* begin() { return moves; }
+    Move* end() { return moves + count; }
+    const Move* begin() const { return moves; }
+    const Move* end() const { return moves + count; }
+
+    bool contains(Move m) const {
+        for (Move listed : *this) {
+            if (listed == m) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+private:
+    Move moves[CAPACITY];
+    size_t count{0};
+};
+
+// A read-only window onto moves stored elsewhere, eg a MoveList. Only valid while they are
+class MoveView {
+public:
+    MoveView() = default;
+    MoveView(const Move* moves, size_t count) : moves{moves}, count{count} {}
+    MoveView(const MoveList& list) : moves{list.begin()}, count{list.size()} {}
+
+    size_t size() const { return count; }
+    bool empty() const { return count == 0; }
+    const Move& operator [] (size_t i) const { return moves[i]; }
+    const Move* begin() const { return moves; }
+    const Move* end() const { return moves + count; }
+
+private:
+    const Move* moves{nullptr};
+    size_t count{0};
+};
+
+#endif //CHESSAMATEUR3_MOVELIST_H
@@ -0,0 +1,263 @@
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+
+#include "MoveOrdering.h"
+
+using namespace CA3;
+
+constexpr int MoveOrdering::MAX_PLY;
+
+namespace {
+    // Each stage's scores lie above every score of the stages after it. Quiet moves score their history,
+    // which stays within +-HISTORY_MAX
+    constexpr int HASH_SCORE = 1 << 30;
+    constexpr int CAPTURE_SCORE = 1 << 28;
+    constexpr int KILLER_SCORE = 1 << 27;
+    constexpr int COUNTERMOVE_SCORE = 1 << 26;
+
+    // The piece a promotion creates, or NO_PIECE
+    int promotionValue(Move m) {
+        switch (m.type) {
+            case PROMOTION_QUEEN:
+            case PROMOTION_QUEEN_CAPTURE:
+                return PIECE_VALUES[QUEEN_INDEX];
+            case PROMOTION_ROOK:
+            case PROMOTION_ROOK_CAPTURE:
+                return PIECE_VALUES[ROOK_INDEX];
+            case PROMOTION_BISHOP:
+            case PROMOTION_BISHOP_CAPTURE:
+                return PIECE_VALUES[BISHOP_INDEX];
+            case PROMOTION_KNIGHT:
+            case PROMOTION_KNIGHT_CAPTURE:
+                return PIECE_VALUES[KNIGHT_INDEX];
+            default:
+                return 0;
+        }
+    }
+
+    int captureScore(const GameState& gs, Move m) {
+        int victim = m.type == EN_PASSANT ? PIECE_VALUES[PAWN_INDEX] : pieceValue(gs[m.to]);
+        return CAPTURE_SCORE + 16 * (victim + promotionValue(m)) - pieceValue(gs[m.from]) / 16;
+    }
+}
+
+MoveOrdering::MoveOrdering() {
+    clear();
+}
+
+void MoveOrdering::clear() {
+    std::fill(&killers[0][0], &killers[0][0] + MAX_PLY * 2, Move{});
+    std::fill(&counterMoves[0][0], &counterMoves[0][0] + 64 * 64, Move{});
+    memset(history, 0, sizeof(history));
+    statistics = Stats{};
+}
+
+void MoveOrdering::newSearch() {
+    std::fill(&killers[0][0], &killers[0][0] + MAX_PLY * 2, Move{});
+    for (int& h : reinterpret_cast<int (&)[2 * 64 * 64]>(history)) {
+        h /= 2;
+    }
+    statistics = Stats{};
+}
+
+void MoveOrdering::score(const GameState& gs, const MoveList& moves, Move hashMove, int ply, Move previous,
+                         int* scores) const {
+    const auto& sideHistory = history[colorIndex(gs.getToAct())];
+    Move counter = counterMoves[previous.from][previous.to];
+
+    for (size_t i = 0; i < moves.size(); i++) {
+        Move m = moves[i];
+
+        if (m == hashMove) {
+            scores[i] = HASH_SCORE;
+        } else if (m.isCapture() || m.isPromotion()) {
+            scores[i] = captureScore(gs, m);
+        } else if (m == killers[ply][0]) {
+            scores[i] = KILLER_SCORE + 1;
+        } else if (m == killers[ply][1]) {
+            scores[i] = KILLER_SCORE;
+        } else if (m == counter) {
+            scores[i] = COUNTERMOVE_SCORE;
+        } else {
+            scores[i] = sideHistory[m.from][m.to];
+        }
+    }
+}
+
+MoveOrdering::Stage MoveOrdering::stageOf(int moveScore) {
+    if (moveScore >= HASH_SCORE) {
+        return HASH_MOVE;
+    } else if (moveScore >= CAPTURE_SCORE) {
+        return CAPTURE;
+    } else if (moveScore >= KILLER_SCORE) {
+        return KILLER;
+    } else if (moveScore >= COUNTERMOVE_SCORE) {
+        return COUNTERMOVE;
+    }
+    return QUIET;
+}
+
+void MoveOrdering::recordCutoff(const GameState& gs, Move m, int moveScore, int moveNumber, int ply, int depth,
+                                Move previous, const MoveList& quietsTried, bool learn) {
+    statistics.cutNodes++;
+    statistics.firstMoveCutoffs += moveNumber == 0;
+    statistics.movesBeforeCutoff += moveNumber + 1;
+    statistics.cutoffsByStage[stageOf(moveScore)]++;
+
+    // Captures are already ordered well by what they capture
+    if (!learn || m.isCapture() || m.isPromotion()) {
+        return;
+    }
+
+    if (killers[ply][0] != m) {
+        killers[ply][1] = killers[ply][0];
+        killers[ply][0] = m;
+    }
+    counterMoves[previous.from][previous.to] = m;
+
+    // Deeper cutoffs save more work, so they count for more
+    int bonus = std::min(depth * depth, HISTORY_MAX / 4);
+    updateHistory(gs.getToAct(), m, bonus);
+    for (Move quiet : quietsTried) {
+        updateHistory(gs.getToAct(), quiet, -bonus);
+    }
+}
+
+// Moves the entry toward +-HISTORY_MAX by a step that shrinks as it gets closer, so it never leaves that range
+// and recent results outweigh old ones
+void MoveOrdering::updateHistory(Color c, Move m, int bonus) {
+    int& entry = history[colorIndex(c)][m.from][m.to];
+    entry += bonus - entry * std::abs(bonus) / HISTORY_MAX;
+}
+
+StagedMovePicker::StagedMovePicker(GameState& gs, const MoveOrdering* ordering, MoveList& moves, int* scores,
+                                   Move hashMove, int ply, Move previous, bool inCheck)
+        : gs{&gs}, ordering{ordering}, moves{&moves}, scores{scores}, hashMove{hashMove}, ply{ply},
+          previous{previous}, inCheck{inCheck} {
+    moves.clear();
+    stage = hashMove != Move{} && gs.isLegal(hashMove) ? TRY_HASH : firstGeneration();
+}
+
+StagedMovePicker::Stage StagedMovePicker::firstGeneration() const {
+    return !ordering ? GENERATE_ALL : inCheck ? GENERATE_EVASIONS : GENERATE_CAPTURES;
+}
+
+bool StagedMovePicker::next(Move& m, int& moveScore) {
+    while (true) {
+        switch (stage) {
+            case TRY_HASH:
+                stage = firstGeneration();
+                m = hashMove;
+                moveScore = HASH_SCORE;
+                return true;
+
+            case GENERATE_CAPTURES:
+                gs->generate<CAPTURES>(*moves);
+                for (size_t i = 0; i < moves->size(); i++) {
+                    scores[i] = captureScore(*gs, (*moves)[i]);
+                }
+                stage = PICK_CAPTURES;
+                break;
+
+            case PICK_CAPTURES:
+                if (pickBest(m, moveScore)) {
+                    return true;
+                }
+                stage = TRY_REFUTATIONS;
+                break;
+
+            // Killers and the countermove come from other positions, so each is only tried if it's a valid quiet
+            // move here that hasn't been tried already
+            case TRY_REFUTATIONS:
+                while (refutationCount < 3) {
+                    Move refutation = refutationAt(refutationCount);
+                    int score = refutationCount == 0 ? KILLER_SCORE + 1
+                              : refutationCount == 1 ? KILLER_SCORE : COUNTERMOVE_SCORE;
+                    bool fresh = refutation != Move{} && refutation != hashMove && !isTried(refutation) &&
+                                 !refutation.isCapture() && !refutation.isPromotion() && gs->isLegal(refutation);
+                    refutations[refutationCount++] = fresh ? refutation : Move{};
+                    if (fresh) {
+                        m = refutation;
+                        moveScore = score;
+                        return true;
+                    }
+                }
+                stage = GENERATE_QUIETS;
+                break;
+
+            case GENERATE_QUIETS: {
+                size_t first = moves->size();
+                gs->generate<QUIETS>(*moves);
+                const auto& sideHistory = ordering->history[colorIndex(gs->getToAct())];
+                for (size_t i = first; i < moves->size(); i++) {
+                    scores[i] = sideHistory[(*moves)[i].from][(*moves)[i].to];
+                }
+                stage = PICK_REST;
+                break;
+            }
+
+            case GENERATE_EVASIONS:
+                gs->generate<EVASIONS>(*moves);
+                ordering->score(*gs, *moves, hashMove, ply, previous, scores);
+                stage = PICK_REST;
+                break;
+
+            case GENERATE_ALL:
+                gs->generate<ALL>(*moves);
+                std::fill(scores, scores + moves->size(), 0);
+                stage = PICK_REST;
+                break;
+
+            case PICK_REST:
+                if (pickBest(m, moveScore)) {
+                    return true;
+                }
+                stage = DONE;
+                break;
+
+            case DONE:
+                return false;
+        }
+    }
+}
+
+Move StagedMovePicker::refutationAt(int i) const {
+    if (i < 2) {
+        return ordering->killers[ply][i];
+    }
+    return ordering->counterMoves[previous.from][previous.to];
+}
+
+bool StagedMovePicker::isTried(Move m) const {
+    for (int i = 0; i < refutationCount; i++) {
+        if (refutations[i] == m) {
+            return true;
+        }
+    }
+    return m == hashMove && stage != TRY_HASH;
+}
+
+// Most nodes cut off after a move or two, so rather than sorting everything up front, each call finds the best
+// move left. Moves already handed out by an earlier stage are skipped
+bool StagedMovePicker::pickBest(Move& m, int& moveScore) {
+    MoveList& ms = *moves;
+    while (picked < ms.size()) {
+        size_t best = picked;
+        for (size_t i = picked + 1; i < ms.size(); i++) {
+            if (scores[i] > scores[best]) {
+                best = i;
+            }
+        }
+
+        std::swap(ms[picked], ms[best]);
+        std::swap(scores[picked], scores[best]);
+        m = ms[picked];
+        moveScore = scores[picked];
+        picked++;
+        if (!isTried(m)) {
+            return true;
+        }
+    }
+    return false;
+}
@@ -0,0 +1,114 @@
+#ifndef CHESSAMATEUR3_MOVEORDERING_H
+#define CHESSAMATEUR3_MOVEORDERING_H
+
+#include <stdint.h>
+#include "GameState.h"
+#include "Move.h"
+#include "MoveList.h"
+
+// Alpha-beta cuts off a node as soon as one move is good enough, so the sooner the best move is tried the smaller
+// the tree. MoveOrdering scores each move at a node from what the search has learned so far, in this order:
+// - The hash move: the best move found for this position by an earlier search
+// - Captures and promotions, most valuable victim first, then least valuable attacker (MVV-LVA)
+// - Killer moves: quiet moves that caused a cutoff at the same ply elsewhere in the tree
+// - The countermove: the quiet move that last refuted the opponent's previous move
+// - Other quiet moves, by how often they've caused cutoffs anywhere (the butterfly history table)
+
+// StagedMovePicker then hands the moves out best first, only generating each group when the search gets to it.
+
+class MoveOrdering {
+public:
+    static constexpr int MAX_PLY = 128;
+
+    // Which of the groups above a move was scored in
+    enum Stage : uint8_t { HASH_MOVE = 0, CAPTURE, KILLER, COUNTERMOVE, QUIET, STAGE_COUNT };
+
+    struct Stats {
+        uint64_t cutNodes; // Nodes where a move failed high
+        uint64_t firstMoveCutoffs; // Cut nodes where the first move tried failed high
+        uint64_t movesBeforeCutoff; // Summed over cut nodes, counting the move that cut off
+        uint64_t cutoffsByStage[STAGE_COUNT];
+
+        double firstMoveCutoffRate() const { return cutNodes ? (double) firstMoveCutoffs / cutNodes : 0; }
+        double averageMovesBeforeCutoff() const { return cutNodes ? (double) movesBeforeCutoff / cutNodes : 0; }
+    };
+
+    MoveOrdering();
+
+    // Forgets everything, eg for a new game
+    void clear();
+
+    // Killers are only useful within a search and statistics are per search. History carries over, but fades
+    void newSearch();
+
+    // Fills scores with a score for each move, higher to be tried first. previous is the move that led to gs.
+    // scores needs room for moves.size() entries
+    void score(const GameState& gs, const MoveList& moves, Move hashMove, int ply, Move previous, int* scores) const;
+
+    // Records that the move with the given score failed high at a node, after moveNumber other moves were tried.
+    // quietsTried lists the quiet moves searched before it, which are marked down in the history table.
+    // If learn is false, only the statistics are updated
+    void recordCutoff(const GameState& gs, Move m, int moveScore, int moveNumber, int ply, int depth, Move previous,
+                      const MoveList& quietsTried, bool learn = true);
+
+    static Stage stageOf(int moveScore);
+
+    const Stats& stats() const { return statistics; }
+
+private:
+    static constexpr int HISTORY_MAX = 16384;
+
+    Move killers[MAX_PLY][2];
+    Move counterMoves[64][64]; // Indexed by the previous move's from and to squares
+    int history[2][64][64]; // Indexed by colorIndex, from and to
+    Stats statistics;
+
+    void updateHistory(CA3::Color c, Move m, int bonus);
+
+    friend class StagedMovePicker;
+};
+
+// Hands out a position's moves in MoveOrdering's order, generating them a group at a time. The hash move is tried
+// before anything is generated. After it come the captures, then the killers and countermove, each checked for
+// legality on its own. Quiet moves are generated last, and only if nothing earlier caused a cutoff. In check, every
+// evasion is generated and scored at once, since there are few. Without a MoveOrdering, the hash move is followed
+// by every other move in generation order
+class StagedMovePicker {
+public:
+    StagedMovePicker() = default;
+
+    // Moves are generated into moves, and scores needs room for MoveList::CAPACITY. previous is the move that
+    // led to gs. gs must not change between calls to next, except for moves that are taken back before the next call
+    StagedMovePicker(GameState& gs, const MoveOrdering* ordering, MoveList& moves, int* scores, Move hashMove,
+                     int ply, Move previous, bool inCheck);
+
+    // Returns false once every move has been handed out. Scores are those MoveOrdering would give
+    bool next(Move& m, int& moveScore);
+
+private:
+    enum Stage : uint8_t {
+        TRY_HASH, GENERATE_CAPTURES, PICK_CAPTURES, TRY_REFUTATIONS, GENERATE_QUIETS, GENERATE_EVASIONS, GENERATE_ALL,
+        PICK_REST, DONE
+    };
+
+    GameState* gs{nullptr};
+    const MoveOrdering* ordering{nullptr};
+    MoveList* moves{nullptr};
+    int* scores{nullptr};
+    Move hashMove;
+    int ply{0};
+    Move previous;
+    bool inCheck{false};
+
+    Stage stage{DONE};
+    size_t picked{0};
+    Move refutations[3]; // The killers and countermove, as they were tried. Default if they weren't
+    int refutationCount{0};
+
+    Stage firstGeneration() const;
+    Move refutationAt(int i) const;
+    bool isTried(Move m) const;
+    bool pickBest(Move& m, int& moveScore);
+};
+
+#endif //CHESSAMATEUR3_MOVEORDERING_H
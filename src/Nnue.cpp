@@ -0,0 +1,270 @@
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <fstream>
+
+#include "Nnue.h"
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__wasm_simd128__)
+#include <wasm_simd128.h>
+#endif
+
+using namespace CA3;
+
+constexpr int Nnue::INPUTS;
+constexpr int Nnue::HIDDEN;
+constexpr int Nnue::ACTIVATION_MAX;
+constexpr int Nnue::OUTPUT_SCALE;
+constexpr int Nnue::EVAL_SCALE;
+
+namespace {
+    constexpr char MAGIC[4] = {'C', 'A', '3', 'N'};
+    constexpr uint32_t VERSION = 1;
+
+    // The kernels. out is parent plus the columns in adds minus those in subs, taken a register at a time so each
+    // element of out is written once. Vectors are loaded unaligned: std::vector only promises 16 byte alignment
+    // before C++17, and unaligned loads of aligned data cost nothing on current hardware
+#if defined(__AVX2__)
+    void applyColumns(const int16_t* parent, int16_t* out, const int16_t* const* adds, int addCount,
+                      const int16_t* const* subs, int subCount) {
+        for (int i = 0; i < Nnue::HIDDEN; i += 16) {
+            __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(parent + i));
+            for (int a = 0; a < addCount; a++) {
+                v = _mm256_add_epi16(v, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(adds[a] + i)));
+            }
+            for (int s = 0; s < subCount; s++) {
+                v = _mm256_sub_epi16(v, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(subs[s] + i)));
+            }
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i), v);
+        }
+    }
+
+    // The dot product of the clamped accumulator with weights. madd multiplies pairs of 16 bit lanes and adds
+    // each pair into a 32 bit lane
+    int32_t clampedDot(const int16_t* acc, const int16_t* weights) {
+        const __m256i zero = _mm256_setzero_si256();
+        const __m256i max = _mm256_set1_epi16(Nnue::ACTIVATION_MAX);
+        __m256i sum = zero;
+
+        for (int i = 0; i < Nnue::HIDDEN; i += 16) {
+            __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(acc + i));
+            v = _mm256_min_epi16(_mm256_max_epi16(v, zero), max);
+            __m256i w = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(weights + i));
+            sum = _mm256_add_epi32(sum, _mm256_madd_epi16(v, w));
+        }
+
+        __m128i half = _mm_add_epi32(_mm256_castsi256_si128(sum), _mm256_extracti128_si256(sum, 1));
+        half = _mm_add_epi32(half, _mm_shuffle_epi32(half, _MM_SHUFFLE(1, 0, 3, 2)));
+        half = _mm_add_epi32(half, _mm_shuffle_epi32(half, _MM_SHUFFLE(2, 3, 0, 1)));
+        return _mm_cvtsi128_si32(half);
+    }
+#elif defined(__wasm_simd128__)
+    void applyColumns(const int16_t* parent, int16_t* out, const int16_t* const* adds, int addCount,
+                      const int16_t* const* subs, int subCount) {
+        for (int i = 0; i < Nnue::HIDDEN; i += 8) {
+            v128_t v = wasm_v128_load(parent + i);
+            for (int a = 0; a < addCount; a++) {
+                v = wasm_i16x8_add(v, wasm_v128_load(adds[a] + i));
+            }
+            for (int s = 0; s < subCount; s++) {
+                v = wasm_i16x8_sub(v, wasm_v128_load(subs[s] + i));
+            }
+            wasm_v128_store(out + i, v);
+        }
+    }
+
+    // dot multiplies pairs of 16 bit lanes and adds each pair into a 32 bit lane
+    int32_t clampedDot(const int16_t* acc, const int16_t* weights) {
+        const v128_t zero = wasm_i16x8_splat(0);
+        const v128_t max = wasm_i16x8_splat(Nnue::ACTIVATION_MAX);
+        v128_t sum = wasm_i32x4_splat(0);
+
+        for (int i = 0; i < Nnue::HIDDEN; i += 8) {
+            v128_t v = wasm_i16x8_min(wasm_i16x8_max(wasm_v128_load(acc + i), zero), max);
+            sum = wasm_i32x4_add(sum, wasm_i32x4_dot_i16x8(v, wasm_v128_load(weights + i)));
+        }
+
+        return wasm_i32x4_extract_lane(sum, 0) + wasm_i32x4_extract_lane(sum, 1) +
+               wasm_i32x4_extract_lane(sum, 2) + wasm_i32x4_extract_lane(sum, 3);
+    }
+#else
+    // A column at a time, so the compiler can vectorize each loop with whatever the target has
+    void applyColumns(const int16_t* parent, int16_t* out, const int16_t* const* adds, int addCount,
+                      const int16_t* const* subs, int subCount) {
+        if (out != parent) {
+            memcpy(out, parent, Nnue::HIDDEN * sizeof(int16_t));
+        }
+        for (int a = 0; a < addCount; a++) {
+            const int16_t* column = adds[a];
+            for (int i = 0; i < Nnue::HIDDEN; i++) {
+                out[i] = (int16_t) (out[i] + column[i]);
+            }
+        }
+        for (int s = 0; s < subCount; s++) {
+            const int16_t* column = subs[s];
+            for (int i = 0; i < Nnue::HIDDEN; i++) {
+                out[i] = (int16_t) (out[i] - column[i]);
+            }
+        }
+    }
+
+    int32_t clampedDot(const int16_t* acc, const int16_t* weights) {
+        int32_t sum = 0;
+        for (int i = 0; i < Nnue::HIDDEN; i++) {
+            int32_t v = std::min(std::max((int32_t) acc[i], 0), (int32_t) Nnue::ACTIVATION_MAX);
+            sum += v * weights[i];
+        }
+        return sum;
+    }
+#endif
+
+    template<typename T>
+    void readArray(std::istream& in, T* values, size_t count) {
+        in.read(reinterpret_cast<char*>(values), (std::streamsize) (count * sizeof(T)));
+        if (!in) {
+            throw Error("Network file is truncated");
+        }
+    }
+
+    template<typename T>
+    void writeArray(std::ostream& out, const T* values, size_t count) {
+        out.write(reinterpret_cast<const char*>(values), (std::streamsize) (count * sizeof(T)));
+    }
+}
+
+Nnue::Nnue()
+        : featureWeights((size_t) INPUTS * HIDDEN), featureBiases(HIDDEN), outputWeights(2 * HIDDEN) {}
+
+Nnue::Nnue(const std::string& path) : Nnue() {
+    std::ifstream in{path, std::ios::binary};
+    if (!in) {
+        throw Error("Couldn't open network file " + path);
+    }
+    load(in);
+}
+
+// The weights are stored as they lie in memory, which is little endian on every platform we build for
+void Nnue::load(std::istream& in) {
+    char magic[4];
+    uint32_t header[2];
+    in.read(magic, sizeof(magic));
+    readArray(in, header, 2);
+    if (memcmp(magic, MAGIC, sizeof(MAGIC)) != 0) {
+        throw Error("Not a network file");
+    }
+    if (header[0] != VERSION || header[1] != (uint32_t) HIDDEN) {
+        throw Error("Network file is version " + std::to_string(header[0]) + " with " + std::to_string(header[1]) +
+                    " hidden neurons, expected version " + std::to_string(VERSION) + " with " +
+                    std::to_string(HIDDEN));
+    }
+
+    readArray(in, featureWeights.data(), featureWeights.size());
+    readArray(in, featureBiases.data(), featureBiases.size());
+    readArray(in, outputWeights.data(), outputWeights.size());
+    readArray(in, &outputBias, 1);
+}
+
+void Nnue::save(std::ostream& out) const {
+    const uint32_t header[2] = {VERSION, (uint32_t) HIDDEN};
+    out.write(MAGIC, sizeof(MAGIC));
+    writeArray(out, header, 2);
+    writeArray(out, featureWeights.data(), featureWeights.size());
+    writeArray(out, featureBiases.data(), featureBiases.size());
+    writeArray(out, outputWeights.data(), outputWeights.size());
+    writeArray(out, &outputBias, 1);
+}
+
+// Small enough that no accumulator can overflow, even with every piece promoted to a queen
+void Nnue::randomize(uint64_t seed) {
+    auto next = [&seed](int range) {
+        seed = seed * 6364136223846793005ull + 1442695040888963407ull;
+        return (int16_t) ((int) (seed >> 33u) % (2 * range + 1) - range);
+    };
+
+    for (int16_t& w : featureWeights) {
+        w = next(64);
+    }
+    for (int16_t& b : featureBiases) {
+        b = next(64);
+    }
+    for (int16_t& w : outputWeights) {
+        w = next(64);
+    }
+    outputBias = next(1000);
+}
+
+int Nnue::featureIndex(Color perspective, Piece p, Square s) {
+    int own = pieceColor(p) == perspective ? 0 : 1;
+    Square relative = perspective == WHITE ? s ^ 56u : s; // a1 is 0 from white's side, a8 from black's
+    return (own * 6 + typeIndex(p)) * 64 + relative;
+}
+
+void Nnue::refresh(const GameState& gs, Accumulator& acc) const {
+    for (Color perspective : {BLACK, WHITE}) {
+        const int16_t* columns[32];
+        int count = 0;
+        int16_t* values = acc.values[colorIndex(perspective)];
+        memcpy(values, featureBiases.data(), sizeof(acc.values[0]));
+
+        for (Bitboard remaining = gs.occupied(); remaining;) {
+            Square s = popLsb(remaining);
+            columns[count++] = &featureWeights[(size_t) featureIndex(perspective, gs[s], s) * HIDDEN];
+            if (count == 32) {
+                applyColumns(values, values, columns, count, nullptr, 0);
+                count = 0;
+            }
+        }
+
+        applyColumns(values, values, columns, count, nullptr, 0);
+    }
+}
+
+// A changed square removes at most one piece and adds at most one, so four changes need four columns of each
+void Nnue::update(const Accumulator& parent, const GameState::MoveChanges& changes, Accumulator& acc) const {
+    assert(changes.count <= 4);
+    for (Color perspective : {BLACK, WHITE}) {
+        const int16_t* adds[4];
+        const int16_t* subs[4];
+        int addCount = 0, subCount = 0;
+
+        for (int i = 0; i < changes.count; i++) {
+            const GameState::PieceChange& change = changes.changes[i];
+            if (change.removed != NO_PIECE) {
+                subs[subCount++] = &featureWeights[(size_t) featureIndex(perspective, change.removed, change.square) *
+                                                   HIDDEN];
+            }
+            if (change.added != NO_PIECE) {
+                adds[addCount++] = &featureWeights[(size_t) featureIndex(perspective, change.added, change.square) *
+                                                   HIDDEN];
+            }
+        }
+
+        int side = colorIndex(perspective);
+        applyColumns(parent.values[side], acc.values[side], adds, addCount, subs, subCount);
+    }
+}
+
+int Nnue::evaluate(const Accumulator& acc, Color toAct) const {
+    int us = colorIndex(toAct);
+    int64_t sum = outputBias + (int64_t) clampedDot(acc.values[us], outputWeights.data()) +
+                  clampedDot(acc.values[1 - us], outputWeights.data() + HIDDEN);
+    return (int) (sum * EVAL_SCALE / (ACTIVATION_MAX * OUTPUT_SCALE));
+}
+
+int Nnue::evaluate(const GameState& gs) const {
+    Accumulator acc;
+    refresh(gs, acc);
+    return evaluate(acc, gs.getToAct());
+}
+
+const char* Nnue::kernelName() {
+#if defined(__AVX2__)
+    return "AVX2";
+#elif defined(__wasm_simd128__)
+    return "wasm SIMD128";
+#else
+    return "scalar";
+#endif
+}
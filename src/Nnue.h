@@ -0,0 +1,81 @@
+#ifndef CHESSAMATEUR3_NNUE_H
+#define CHESSAMATEUR3_NNUE_H
+
+#include <istream>
+#include <ostream>
+#include <string>
+#include <vector>
+#include <stdint.h>
+#include "GameState.h"
+
+// An efficiently updatable neural network evaluator. The input is every piece on its square, seen from each
+// side: one of 768 features (piece type, whether it's that side's own, and square, flipped for black) per piece.
+// The first layer turns each side's features into a HIDDEN wide accumulator, which is just the sum of the
+// weight columns of the features present, so a move only has to add and subtract the columns of the few
+// pieces it changes (see GameState::getLastChanges). The output layer clamps both accumulators to
+// [0, ACTIVATION_MAX], side to act first, and takes their dot product with the output weights.
+
+// Weights are int16, quantized by ACTIVATION_MAX in the first layer and OUTPUT_SCALE in the output layer, so the
+// accumulators fit in 16 bits and the dot product in 32. The hot loops use AVX2 natively, wasm SIMD128 in the
+// browser (with -msimd128) and plain loops otherwise, chosen when compiling (see kernelName)
+
+// Example usage with incremental updates:
+
+// Nnue network{"network.bin"};
+// Nnue::Accumulator root, child;
+// network.refresh(gs, root);
+// gs.makeMove(m);
+// network.update(root, gs.getLastChanges(), child);
+// int score = network.evaluate(child, gs.getToAct());
+
+class Nnue {
+public:
+    static constexpr int INPUTS = 768;
+    static constexpr int HIDDEN = 256;
+    static constexpr int ACTIVATION_MAX = 255;
+    static constexpr int OUTPUT_SCALE = 64;
+    static constexpr int EVAL_SCALE = 400; // Centipawns per unit of network output
+
+    // Indexed by the colorIndex of the side whose view it is
+    struct Accumulator {
+        int16_t values[2][HIDDEN];
+    };
+
+    // A network with every weight zero, which scores everything 0
+    Nnue();
+
+    // Loads a network saved by save. Throws an Error if the file can't be read or doesn't hold a network
+    explicit Nnue(const std::string& path);
+
+    // The format is a header ("CA3N", version and HIDDEN as uint32) then, all little endian, the feature weights
+    // (int16, HIDDEN per feature), feature biases (int16), output weights (int16, the side to act's HIDDEN then
+    // the other side's) and output bias (int32)
+    void load(std::istream& in);
+    void save(std::ostream& out) const;
+
+    // Fills the weights with small random values. Only useful for testing and benchmarking the machinery
+    void randomize(uint64_t seed);
+
+    // Builds both accumulators from every piece on the board
+    void refresh(const GameState& gs, Accumulator& acc) const;
+
+    // Sets acc to parent with changes applied, eg the changes of the move from parent's position
+    void update(const Accumulator& parent, const GameState::MoveChanges& changes, Accumulator& acc) const;
+
+    // Scores are in centipawns from the point of view of the side to act
+    int evaluate(const Accumulator& acc, CA3::Color toAct) const;
+    int evaluate(const GameState& gs) const;
+
+    // The instruction set the kernels were compiled for
+    static const char* kernelName();
+
+private:
+    std::vector<int16_t> featureWeights; // INPUTS by HIDDEN
+    std::vector<int16_t> featureBiases;
+    std::vector<int16_t> outputWeights; // 2 by HIDDEN
+    int32_t outputBias{0};
+
+    static int featureIndex(CA3::Color perspective, CA3::Piece p, CA3::Square s);
+};
+
+#endif //CHESSAMATEUR3_NNUE_H
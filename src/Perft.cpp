@@ -0,0 +1,239 @@
+#include <sstream>
+#include <thread>
+
+#include "Perft.h"
+
+using namespace CA3;
+using std::string;
+using std::vector;
+
+namespace {
+    // Walks the tree in place, taking back each move after counting below it
+    uint64_t countNodes(GameState& gs, int depth, PerftCache* cache) {
+        MoveList moves;
+        gs.generateMoves(moves);
+        if (depth == 1) {
+            return moves.size();
+        }
+
+        uint64_t key = 0;
+        uint64_t nodes = 0;
+        if (cache) {
+            key = gs.getKey();
+            if (cache->probe(key, depth, nodes)) {
+                return nodes;
+            }
+        }
+
+        for (Move m : moves) {
+            gs.makeMove(m);
+            nodes += countNodes(gs, depth - 1, cache);
+            gs.unmakeMove();
+        }
+
+        if (cache) {
+            cache->store(key, depth, nodes);
+        }
+        return nodes;
+    }
+
+    Square parseSquare(const string& s) {
+        if (s.length() != 2 || s[0] < 'a' || s[0] > 'h' || s[1] < '1' || s[1] > '8') {
+            throw Error{"Invalid FEN: bad en passant square " + s};
+        }
+        return (Square) ((s[0] - 'a') + 8 * ('8' - s[1]));
+    }
+}
+
+PerftCache::PerftCache(size_t megabytes) {
+    size_t count = 1;
+    while (count * 2 * sizeof(Entry) <= megabytes * 1024 * 1024) {
+        count *= 2;
+    }
+
+    entries.reset(new Entry[count]);
+    mask = count - 1;
+    for (size_t i = 0; i < count; i++) {
+        entries[i].check.store(0, std::memory_order_relaxed);
+        entries[i].data.store(0, std::memory_order_relaxed);
+    }
+}
+
+// Depth lives in the top byte of data, the node count in the rest
+bool PerftCache::probe(uint64_t key, int depth, uint64_t& nodes) const {
+    const Entry& e = entries[key & mask];
+    uint64_t data = e.data.load(std::memory_order_relaxed);
+    uint64_t check = e.check.load(std::memory_order_relaxed);
+
+    if ((check ^ data) != key || (int) (data >> 56u) != depth) {
+        return false;
+    }
+
+    nodes = data & 0x00ff'ffff'ffff'ffffull;
+    return true;
+}
+
+void PerftCache::store(uint64_t key, int depth, uint64_t nodes) {
+    Entry& e = entries[key & mask];
+    uint64_t data = ((uint64_t) depth << 56u) | nodes;
+    e.data.store(data, std::memory_order_relaxed);
+    e.check.store(key ^ data, std::memory_order_relaxed);
+}
+
+uint64_t perft(const GameState& gs, int depth, PerftCache* cache) {
+    if (depth < 1) {
+        return 1;
+    }
+
+    GameState walker{gs};
+    return countNodes(walker, depth, cache);
+}
+
+vector<PerftDivision> perftDivide(const GameState& gs, int depth, unsigned threads, PerftCache* cache) {
+    vector<PerftDivision> divisions;
+    for (Move m : GameState{gs}.generateMoves()) {
+        divisions.push_back({m, 0});
+    }
+
+    // Each thread walks its own copy of the root, taking the next unclaimed root move until none are left
+    std::atomic<size_t> nextMove{0};
+    auto work = [&]() {
+        GameState walker{gs};
+        for (size_t i; (i = nextMove++) < divisions.size();) {
+            walker.makeMove(divisions[i].move);
+            divisions[i].nodes = depth > 1 ? countNodes(walker, depth - 1, cache) : 1;
+            walker.unmakeMove();
+        }
+    };
+
+    vector<std::thread> helpers;
+    for (unsigned t = 1; t < threads; t++) {
+        helpers.emplace_back(work);
+    }
+    work();
+    for (auto& helper : helpers) {
+        helper.join();
+    }
+
+    return divisions;
+}
+
+GameState parseFen(const string& fen) {
+    std::istringstream in{fen};
+    string board, toAct, castling = "-", enPassant = "-";
+
+    if (!(in >> board >> toAct)) {
+        throw Error{"Invalid FEN: missing board or side to move"};
+    }
+    in >> castling >> enPassant;
+
+    GameState gs;
+    gs.makeEmpty();
+
+    static const string pieceChars = "pnbrqkPNBRQK";
+    static const Piece pieceValues[] = {BLACK_PAWN, BLACK_KNIGHT, BLACK_BISHOP, BLACK_ROOK, BLACK_QUEEN, BLACK_KING,
+                                        WHITE_PAWN, WHITE_KNIGHT, WHITE_BISHOP, WHITE_ROOK, WHITE_QUEEN, WHITE_KING};
+    int square = 0;
+    for (char c : board) {
+        if (c == '/') {
+            if (square % 8 != 0) {
+                throw Error{"Invalid FEN: ranks must have 8 squares"};
+            }
+        } else if (c >= '1' && c <= '8') {
+            square += c - '0';
+        } else {
+            size_t index = pieceChars.find(c);
+            if (index == string::npos || square > 63) {
+                throw Error{string("Invalid FEN: unexpected character ") + c};
+            }
+
+            Piece p = pieceValues[index];
+            gs[(Square) square] = p;
+            if (p == WHITE_KING) {
+                gs.setWhiteKingLocation((Square) square);
+            } else if (p == BLACK_KING) {
+                gs.setBlackKingLocation((Square) square);
+            }
+            square++;
+        }
+    }
+
+    if (square != 64) {
+        throw Error{"Invalid FEN: boards must have 64 squares"};
+    }
+
+    if (toAct == "w") {
+        gs.setToAct(WHITE);
+    } else if (toAct == "b") {
+        gs.setToAct(BLACK);
+    } else {
+        throw Error{"Invalid FEN: side to move must be w or b"};
+    }
+
+    for (char c : castling) {
+        switch (c) {
+            case 'K':
+                gs.setWhiteRookEastLocation(63);
+                break;
+            case 'Q':
+                gs.setWhiteRookWestLocation(56);
+                break;
+            case 'k':
+                gs.setBlackRookEastLocation(7);
+                break;
+            case 'q':
+                gs.setBlackRookWestLocation(0);
+                break;
+            case '-':
+                break;
+            default:
+                throw Error{string("Invalid FEN: unexpected castling character ") + c};
+        }
+    }
+
+    if (enPassant != "-") {
+        gs.setEnPassantSquare(parseSquare(enPassant));
+    }
+
+    return gs;
+}
+
+string moveToString(Move m) {
+    Square to = m.to;
+
+    // Castles store the rook's square, but the king's destination is the conventional notation
+    if (m.type == CASTLE_EAST) {
+        to = m.from < 8 ? CASTLE_EAST_BLACK_KING : CASTLE_EAST_WHITE_KING;
+    } else if (m.type == CASTLE_WEST) {
+        to = m.from < 8 ? CASTLE_WEST_BLACK_KING : CASTLE_WEST_WHITE_KING;
+    }
+
+    string ret;
+    ret += (char) ('a' + m.from % 8);
+    ret += (char) ('8' - m.from / 8);
+    ret += (char) ('a' + to % 8);
+    ret += (char) ('8' - to / 8);
+
+    switch (m.type) {
+        case PROMOTION_QUEEN:
+        case PROMOTION_QUEEN_CAPTURE:
+            ret += 'q';
+            break;
+        case PROMOTION_ROOK:
+        case PROMOTION_ROOK_CAPTURE:
+            ret += 'r';
+            break;
+        case PROMOTION_BISHOP:
+        case PROMOTION_BISHOP_CAPTURE:
+            ret += 'b';
+            break;
+        case PROMOTION_KNIGHT:
+        case PROMOTION_KNIGHT_CAPTURE:
+            ret += 'n';
+            break;
+        default:
+            break;
+    }
+
+    return ret;
+}
@@ -0,0 +1,55 @@
+#ifndef CHESSAMATEUR3_PERFT_H
+#define CHESSAMATEUR3_PERFT_H
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <vector>
+#include <stdint.h>
+#include "GameState.h"
+#include "Move.h"
+
+// Perft ("performance test") walks the tree of legal moves to a fixed depth and counts the leaves.
+// The counts can be compared against well-known values to validate move generation, and timing
+// them measures how fast generateMoves and makeMove run.
+
+// Hashed node counts keyed by position and depth. Each entry stores the key XORed with its data,
+// so a torn write from another thread shows up as a miss instead of a wrong count
+class PerftCache {
+public:
+    explicit PerftCache(size_t megabytes);
+
+    bool probe(uint64_t key, int depth, uint64_t& nodes) const;
+    void store(uint64_t key, int depth, uint64_t nodes);
+
+private:
+    struct Entry {
+        std::atomic<uint64_t> check;
+        std::atomic<uint64_t> data;
+    };
+
+    std::unique_ptr<Entry[]> entries;
+    size_t mask;
+};
+
+struct PerftDivision {
+    Move move;
+    uint64_t nodes;
+};
+
+// Counts the leaves of the move tree rooted at gs. Leaves are counted in bulk from the size of the
+// last generated move list rather than by making each move
+uint64_t perft(const GameState& gs, int depth, PerftCache* cache = nullptr);
+
+// Same count as perft, but split by root move. The root moves are shared out among threads
+std::vector<PerftDivision> perftDivide(const GameState& gs, int depth, unsigned threads = 1,
+                                       PerftCache* cache = nullptr);
+
+// Builds a GameState from the board, side to move, castling and en passant fields of a FEN string.
+// Move counters are ignored. Throws an Error if the FEN can't be read
+GameState parseFen(const std::string& fen);
+
+// Formats a move in coordinate notation, eg e2e4 or a7a8q
+std::string moveToString(Move m);
+
+#endif //CHESSAMATEUR3_PERFT_H
@@ -0,0 +1,653 @@
+#include <algorithm>
+#include <cmath>
+#include <thread>
+
+#include "Search.h"
+
+using namespace CA3;
+
+constexpr int SearchLimits::MAX_DEPTH;
+constexpr int Search::MAX_PLY;
+constexpr int Search::INFINITE_SCORE;
+constexpr int Search::MATE_SCORE;
+constexpr int Search::MATE_BOUND;
+
+namespace {
+    // How far either side of the last iteration's score the first window of an iteration reaches
+    constexpr int ASPIRATION_WINDOW = 25;
+
+    // Reverse futility and futility pruning only happen this close to the leaves, where the evaluation is a
+    // fair guess at the score. The margins cover how much a few moves could swing it
+    constexpr int FUTILITY_DEPTH = 6;
+    constexpr int REVERSE_FUTILITY_MARGIN = 120; // Per ply of depth
+    constexpr int FUTILITY_MARGIN[3] = {0, 200, 400}; // Indexed by depth
+
+    // Null move searches are reduced by NULL_MOVE_REDUCTION plies, plus another per NULL_MOVE_DEPTH_DIVISOR plies
+    constexpr int NULL_MOVE_MIN_DEPTH = 3;
+    constexpr int NULL_MOVE_REDUCTION = 2;
+    constexpr int NULL_MOVE_DEPTH_DIVISOR = 4;
+
+    // Only moves after the first LMR_MIN_MOVES, at LMR_MIN_DEPTH or more, are reduced
+    constexpr int LMR_MIN_DEPTH = 3;
+    constexpr int LMR_MIN_MOVES = 3;
+
+    // How far to reduce the nth move at a depth. Later moves at deeper nodes are less likely to matter, and
+    // reducing them by more saves more, so the reduction grows with the logarithm of both
+    struct Reductions {
+        int table[64][64];
+
+        Reductions() : table{} {
+            for (int depth = 1; depth < 64; depth++) {
+                for (int moveNumber = 1; moveNumber < 64; moveNumber++) {
+                    table[depth][moveNumber] = (int) (0.75 + std::log(depth) * std::log(moveNumber) / 2.25);
+                }
+            }
+        }
+
+        int operator()(int depth, int moveNumber) const {
+            return table[std::min(depth, 63)][std::min(moveNumber, 63)];
+        }
+    };
+
+    const Reductions lateMoveReduction;
+
+    // Mate scores count plies from the root, but the table is shared by every node that reaches a position,
+    // so store them counting from the position instead
+    int scoreToTable(int score, int ply) {
+        if (score >= Search::MATE_BOUND) {
+            return score + ply;
+        } else if (score <= -Search::MATE_BOUND) {
+            return score - ply;
+        }
+        return score;
+    }
+
+    int scoreFromTable(int score, int ply) {
+        if (score >= Search::MATE_BOUND) {
+            return score - ply;
+        } else if (score <= -Search::MATE_BOUND) {
+            return score + ply;
+        }
+        return score;
+    }
+}
+
+Search::Search(TranspositionTable& tt) : tt{tt} {}
+
+int Search::evaluate(const GameState& gs) {
+    int score = taper(gs.getPieceSquareScore(), gs.getPhase());
+    return gs.getToAct() == WHITE ? score : -score;
+}
+
+void Search::setThreads(unsigned count) {
+    helpers.clear();
+    for (unsigned i = 1; i < count; i++) {
+        helpers.push_back(std::make_unique<Search>(tt));
+        helpers.back()->setNetwork(network);
+    }
+}
+
+void Search::setNetwork(const Nnue* nnue) {
+    network = nnue;
+    accumulators.resize(network ? MAX_PLY : 0);
+    for (auto& helper : helpers) {
+        helper->setNetwork(network);
+    }
+}
+
+// Call after making a move or null move from ply
+void Search::moveMade(int ply) {
+    if (network) {
+        plyChanges[ply + 1] = gs.getLastChanges();
+        accumulatedPly = std::min(accumulatedPly, ply);
+    }
+}
+
+// The network's scores aren't bounded, so keep them clear of mate scores
+int Search::evaluateAt(int ply) {
+    if (!network) {
+        return evaluate(gs);
+    }
+
+    for (; accumulatedPly < ply; accumulatedPly++) {
+        network->update(accumulators[accumulatedPly], plyChanges[accumulatedPly + 1],
+                        accumulators[accumulatedPly + 1]);
+    }
+    int score = network->evaluate(accumulators[ply], gs.getToAct());
+    return std::max(-MATE_BOUND + 1, std::min(score, MATE_BOUND - 1));
+}
+
+void Search::clear() {
+    ordering.clear();
+    for (auto& helper : helpers) {
+        helper->clear();
+    }
+}
+
+SearchResult Search::think(const GameState& root, const SearchLimits& searchLimits,
+                           const std::vector<uint64_t>& history) {
+    tt.newSearch();
+    prepare(root, searchLimits, history, 1);
+    if (finished) {
+        return currentResult();
+    }
+
+    // Helpers have no limits of their own; they search until this thread is done. Half of them start a ply
+    // deeper so the threads aren't all on the same iteration. They're prepared here rather than on their own
+    // threads so a stop can't arrive before they've started
+    std::vector<std::thread> threads;
+    for (size_t i = 0; i < helpers.size(); i++) {
+        Search& helper = *helpers[i];
+        helper.options = options;
+        helper.prepare(root, SearchLimits{}, history, 1 + (int) (i & 1u));
+        threads.emplace_back([&helper]() { helper.searchStep(0); });
+    }
+
+    searchStep(0);
+
+    SearchResult final = currentResult();
+    for (size_t i = 0; i < helpers.size(); i++) {
+        helpers[i]->stop();
+        threads[i].join();
+        final.nodes += helpers[i]->nodes;
+    }
+    return final;
+}
+
+void Search::startSearch(const GameState& root, const SearchLimits& searchLimits,
+                         const std::vector<uint64_t>& history) {
+    tt.newSearch();
+    prepare(root, searchLimits, history, 1);
+}
+
+bool Search::searchStep(int64_t budgetUs, uint64_t budgetNodes) {
+    std::chrono::steady_clock::time_point deadline{};
+    if (budgetUs) {
+        deadline = std::chrono::steady_clock::now() + std::chrono::microseconds(budgetUs);
+    }
+    uint64_t nodeLimit = budgetNodes ? nodes + budgetNodes : 0;
+
+    // Only the top node changes from one pass to the next, so the search can pause between any two
+    for (unsigned pass = 1; !finished; pass++) {
+        if ((nodeLimit && nodes >= nodeLimit) ||
+            (budgetUs && (pass & 255u) == 0 && std::chrono::steady_clock::now() >= deadline)) {
+            return true;
+        }
+
+        if (nodeCount == 0) {
+            if (childReturned) {
+                childReturned = false;
+                finishRoot(childScore);
+            } else {
+                searchRoot();
+            }
+            continue;
+        }
+
+        Node& node = nodeStack[nodeCount - 1];
+        if (childReturned) {
+            childReturned = false;
+            if (node.state == Node::AFTER_NULL_MOVE) {
+                afterNullMove(node, -childScore);
+            } else {
+                afterChild(node, -childScore);
+            }
+        } else if (node.state == Node::ENTER) {
+            enterNode(node);
+        } else {
+            searchNextMove(node);
+        }
+    }
+
+    return false;
+}
+
+SearchResult Search::currentResult() const {
+    SearchResult current = result;
+    current.nodes = nodes;
+    current.timeMs = elapsedMs();
+    return current;
+}
+
+void Search::prepare(const GameState& root, const SearchLimits& searchLimits, const std::vector<uint64_t>& history,
+                     int firstDepth) {
+    gs = root;
+    limits = searchLimits;
+    stopped = false;
+    nodes = 0;
+    startTime = std::chrono::steady_clock::now();
+    ordering.newSearch();
+
+    keys = history;
+    keys.push_back(gs.getKey());
+    if (network) {
+        network->refresh(gs, accumulators[0]);
+        accumulatedPly = 0;
+    }
+    nodeCount = 0;
+    childReturned = false;
+
+    result = SearchResult{Move{}, 0, 0, 0, 0, {}};
+    MoveList rootMoves;
+    gs.generateMoves(rootMoves);
+    if (rootMoves.empty()) {
+        result.score = gs.currentPlayerInCheck() ? -MATE_SCORE : 0;
+        finished = true;
+        return;
+    }
+
+    // Have a legal move ready in case the first iteration doesn't finish
+    result.bestMove = rootMoves[0];
+    finished = false;
+    iterationDepth = firstDepth;
+    startIteration();
+}
+
+void Search::startIteration() {
+    if (iterationDepth > std::min(limits.depth, MAX_PLY - 1)) {
+        finished = true;
+        return;
+    }
+
+    windowAlpha = -INFINITE_SCORE;
+    windowBeta = INFINITE_SCORE;
+    windowDelta = ASPIRATION_WINDOW;
+    if (iterationDepth >= 4) {
+        windowAlpha = std::max(result.score - windowDelta, -INFINITE_SCORE);
+        windowBeta = std::min(result.score + windowDelta, (int) INFINITE_SCORE);
+    }
+}
+
+void Search::searchRoot() {
+    pushNode(iterationDepth, 0, windowAlpha, windowBeta);
+}
+
+// Widens whichever side of the window the score fell outside of until it lands inside, then moves on to the
+// next iteration
+void Search::finishRoot(int score) {
+    if (stopped) {
+        finished = true;
+        return;
+    }
+
+    windowDelta *= 2;
+    if (score <= windowAlpha) {
+        windowAlpha = std::max(score - windowDelta, -INFINITE_SCORE);
+        return;
+    } else if (score >= windowBeta) {
+        windowBeta = std::min(score + windowDelta, (int) INFINITE_SCORE);
+        return;
+    }
+
+    result.score = score;
+    result.depth = iterationDepth;
+    result.pv.assign(pv[0], pv[0] + pvLength[0]);
+    if (!result.pv.empty()) {
+        result.bestMove = result.pv[0];
+    }
+    result.nodes = nodes;
+    result.timeMs = elapsedMs();
+
+    if (onIteration) {
+        onIteration(result);
+    }
+
+    // The next iteration would probably take longer than everything so far, so don't start one we can't finish
+    if (limits.timeMs && result.timeMs * 2 > limits.timeMs) {
+        finished = true;
+        return;
+    }
+
+    iterationDepth++;
+    startIteration();
+}
+
+// Starts searching a child of the top node, or the root. Once the depth runs out the quiescence search
+// takes over, and returns at once
+void Search::pushNode(int depth, int ply, int alpha, int beta) {
+    if (depth <= 0) {
+        childScore = quiesce(ply, alpha, beta);
+        childReturned = true;
+        return;
+    }
+
+    Node& node = nodeStack[ply];
+    node.depth = depth;
+    node.ply = ply;
+    node.alpha = alpha;
+    node.beta = beta;
+    node.state = Node::ENTER;
+    nodeCount = ply + 1;
+}
+
+// Hands the score of the top node to its parent
+void Search::finishNode(int score) {
+    nodeCount--;
+    childScore = score;
+    childReturned = true;
+}
+
+void Search::enterNode(Node& node) {
+    int ply = node.ply;
+    int depth = node.depth;
+
+    pvLength[ply] = 0;
+    nodes++;
+    checkLimits();
+    if (stopped) {
+        return finishNode(0);
+    }
+
+    if (ply > 0 && isRepetition()) {
+        return finishNode(0);
+    }
+
+    if (ply >= MAX_PLY - 1) {
+        return finishNode(evaluateAt(ply));
+    }
+
+    // Null window nodes only need to know which side of the window the score is on, so any deep enough
+    // bound that settles that will do. Nodes on the principal variation need exact scores and their lines
+    node.pvNode = node.beta - node.alpha > 1;
+    node.key = gs.getKey();
+    TranspositionTable::Hit hit{};
+    node.hashMove = Move{};
+
+    if (tt.probe(node.key, hit)) {
+        node.hashMove = hit.move;
+        int score = scoreFromTable(hit.score, ply);
+        if (!node.pvNode && hit.depth >= depth &&
+            (hit.bound == TranspositionTable::EXACT ||
+             (hit.bound == TranspositionTable::LOWER && score >= node.beta) ||
+             (hit.bound == TranspositionTable::UPPER && score <= node.alpha))) {
+            return finishNode(score);
+        }
+    }
+
+    // Moves are generated as they're needed, so a node with none is only found once the picker runs dry
+    node.inCheck = gs.currentPlayerInCheck();
+
+    // The pruning below bets that the evaluation is close to the real score, which doesn't hold in check or
+    // when a mate is on the board. PV nodes aren't pruned, so the line the search reports is fully searched
+    bool canPrune = !node.pvNode && !node.inCheck && std::abs(node.beta) < MATE_BOUND;
+    int eval = canPrune ? evaluateAt(ply) : 0;
+
+    if (canPrune && options.reverseFutility && depth <= FUTILITY_DEPTH &&
+        eval - REVERSE_FUTILITY_MARGIN * depth >= node.beta) {
+        return finishNode(eval);
+    }
+
+    node.eval = eval;
+    if (canPrune && options.nullMove && eval >= node.beta && tryNullMove(node)) {
+        return;
+    }
+
+    startMoves(node, canPrune);
+}
+
+// Readies the node's moves to be picked, best first
+void Search::startMoves(Node& node, bool canPrune) {
+    node.futile = canPrune && options.futility && node.depth < 3 &&
+                  node.eval + FUTILITY_MARGIN[node.depth] <= node.alpha;
+
+    node.previous = node.ply > 0 ? moveStack[node.ply - 1] : Move{};
+    node.originalAlpha = node.alpha;
+    node.best = -INFINITE_SCORE;
+    node.bestMove = Move{};
+    node.quietsTried.clear();
+    node.picker = StagedMovePicker{gs, options.moveOrdering ? &ordering : nullptr, node.moves, node.scores,
+                                   node.hashMove, node.ply, node.previous, node.inCheck};
+    node.moveNumber = -1;
+    node.state = Node::NEXT_MOVE;
+}
+
+// Stores the node's result once its moves are done or one has cut it off
+void Search::finishMoves(Node& node) {
+    if (node.moveNumber == -1) {
+        return finishNode(node.inCheck ? -MATE_SCORE + node.ply : 0);
+    }
+
+    TranspositionTable::Bound bound = node.best >= node.beta ? TranspositionTable::LOWER
+                                    : node.best > node.originalAlpha ? TranspositionTable::EXACT
+                                    : TranspositionTable::UPPER;
+    tt.store(node.key, node.depth, bound, scoreToTable(node.best, node.ply), node.bestMove);
+    finishNode(node.best);
+}
+
+// If the side to act could pass and a reduced search still failed high, a real move would almost certainly do at least
+// as well, so the node can be cut without searching any. That fails in zugzwang, where every move makes things
+// worse, so it isn't tried without pieces other than pawns, or twice in a row
+bool Search::tryNullMove(Node& node) {
+    Color us = gs.getToAct();
+    Bitboard pawnsAndKing = gs.pieceBoard(PIECE_PAWN, us) | gs.pieceBoard(PIECE_KING, us);
+    if (node.depth < NULL_MOVE_MIN_DEPTH || (node.ply > 0 && moveStack[node.ply - 1] == Move{}) ||
+        gs.colorBoard(us) == pawnsAndKing) {
+        return false;
+    }
+
+    int reduction = NULL_MOVE_REDUCTION + node.depth / NULL_MOVE_DEPTH_DIVISOR;
+
+    moveStack[node.ply] = Move{};
+    gs.makeNullMove();
+    moveMade(node.ply);
+    keys.push_back(gs.getKey());
+    node.state = Node::AFTER_NULL_MOVE;
+    pushNode(node.depth - 1 - reduction, node.ply + 1, -node.beta, -node.beta + 1);
+    return true;
+}
+
+void Search::afterNullMove(Node& node, int score) {
+    keys.pop_back();
+    gs.unmakeNullMove();
+
+    if (stopped) {
+        return finishNode(0);
+    }
+    if (score >= node.beta) {
+        return finishNode(node.beta);
+    }
+
+    // Null moves are only tried where pruning is allowed
+    startMoves(node, true);
+}
+
+void Search::searchNextMove(Node& node) {
+    int ply = node.ply;
+    int depth = node.depth;
+    Move m;
+
+    while (true) {
+        if (!node.picker.next(m, node.moveScore)) {
+            return finishMoves(node);
+        }
+
+        node.moveNumber++;
+        node.move = m;
+        node.quiet = !m.isCapture() && !m.isPromotion();
+        bool givesCheck = gs.givesCheck(m);
+
+        // Quiet moves can't lift the score from this far below alpha, unless they check
+        if (node.futile && node.quiet && !givesCheck && node.moveNumber > 0) {
+            continue;
+        }
+
+        moveStack[ply] = m;
+        gs.makeMove(m);
+        moveMade(ply);
+
+        keys.push_back(gs.getKey());
+        node.state = Node::AFTER_CHILD;
+
+        if (node.moveNumber == 0) {
+            node.probe = Node::FULL_WINDOW;
+            return pushNode(depth - 1, ply + 1, -node.beta, -node.alpha);
+        }
+
+        // Late quiet moves are searched shallower first, and only searched fully if they beat alpha anyway.
+        // Killers and countermoves have already proven themselves elsewhere, so they aren't reduced
+        node.reduction = 0;
+        if (options.lateMoveReductions && depth >= LMR_MIN_DEPTH && node.moveNumber >= LMR_MIN_MOVES &&
+            node.quiet && !node.inCheck && !givesCheck &&
+            MoveOrdering::stageOf(node.moveScore) == MoveOrdering::QUIET) {
+            node.reduction = lateMoveReduction(depth, node.moveNumber) - node.pvNode;
+            node.reduction = std::max(0, std::min(node.reduction, depth - 2));
+        }
+
+        node.probe = node.reduction > 0 ? Node::REDUCED : Node::NULL_WINDOW;
+        return pushNode(depth - 1 - node.reduction, ply + 1, -node.alpha - 1, -node.alpha);
+    }
+}
+
+void Search::afterChild(Node& node, int score) {
+    int ply = node.ply;
+    int depth = node.depth;
+
+    // A reduced search that beats alpha is checked at full depth, and a null window search that lands inside
+    // the window is repeated with the full window to get the exact score
+    if (!stopped) {
+        if (node.probe == Node::REDUCED && score > node.alpha) {
+            node.probe = Node::NULL_WINDOW;
+            return pushNode(depth - 1, ply + 1, -node.alpha - 1, -node.alpha);
+        }
+        if (node.probe == Node::NULL_WINDOW && score > node.alpha && score < node.beta) {
+            node.probe = Node::FULL_WINDOW;
+            return pushNode(depth - 1, ply + 1, -node.beta, -node.alpha);
+        }
+    }
+
+    keys.pop_back();
+    gs.unmakeMove();
+    node.state = Node::NEXT_MOVE;
+
+    if (stopped) {
+        return finishNode(0);
+    }
+
+    Move m = node.move;
+    if (score > node.best) {
+        node.best = score;
+        node.bestMove = m;
+
+        if (score > node.alpha) {
+            node.alpha = score;
+
+            // This node's line is the move followed by the line below it
+            pv[ply][0] = m;
+            std::copy(pv[ply + 1], pv[ply + 1] + pvLength[ply + 1], pv[ply] + 1);
+            pvLength[ply] = pvLength[ply + 1] + 1;
+
+            if (node.alpha >= node.beta) {
+                ordering.recordCutoff(gs, m, node.moveScore, node.moveNumber, ply, depth, node.previous,
+                                      node.quietsTried, options.moveOrdering);
+                return finishMoves(node);
+            }
+        }
+    }
+
+    if (node.quiet) {
+        node.quietsTried.push_back(m);
+    }
+}
+
+// Only captures and promotions are searched, and the side to act may "stand pat" on the static evaluation instead,
+// since it could usually make a quiet move that keeps it. In check there's no such option, so every evasion is tried
+int Search::quiesce(int ply, int alpha, int beta) {
+    pvLength[ply] = 0;
+    nodes++;
+    checkLimits();
+    if (stopped) {
+        return 0;
+    }
+
+    if (ply >= MAX_PLY - 1) {
+        return evaluateAt(ply);
+    }
+
+    bool inCheck = gs.currentPlayerInCheck();
+    int best = -INFINITE_SCORE;
+
+    if (!inCheck) {
+        best = evaluateAt(ply);
+        if (best >= beta) {
+            return best;
+        }
+        alpha = std::max(alpha, best);
+    }
+
+    // Nodes from this ply on aren't in use until the quiescence search returns, so it borrows their lists
+    MoveList& moves = nodeStack[ply].moves;
+    int* exchanges = nodeStack[ply].scores;
+    moves.clear();
+    if (inCheck) {
+        gs.generate<EVASIONS>(moves);
+        if (moves.empty()) {
+            return -MATE_SCORE + ply;
+        }
+    } else {
+        gs.generate<CAPTURES>(moves);
+    }
+
+    // Best exchanges first, keeping generation order between equals. Captures that lose material are skipped
+    // outright, unless escaping check. The lists are short, so they're insertion sorted in place
+    size_t count = 0;
+    for (Move m : moves) {
+        int exchange = gs.staticExchange(m);
+        if (!inCheck && exchange < 0) {
+            continue;
+        }
+
+        size_t i = count++;
+        for (; i > 0 && exchanges[i - 1] < exchange; i--) {
+            moves[i] = moves[i - 1];
+            exchanges[i] = exchanges[i - 1];
+        }
+        moves[i] = m;
+        exchanges[i] = exchange;
+    }
+
+    for (size_t i = 0; i < count; i++) {
+        gs.makeMove(moves[i]);
+        moveMade(ply);
+        int score = -quiesce(ply + 1, -beta, -alpha);
+        gs.unmakeMove();
+
+        if (stopped) {
+            return 0;
+        }
+
+        if (score > best) {
+            best = score;
+            if (score > alpha) {
+                alpha = score;
+                if (alpha >= beta) {
+                    break;
+                }
+            }
+        }
+    }
+
+    return best;
+}
+
+// Positions repeat with the same side to act, so only every other earlier position can match
+bool Search::isRepetition() const {
+    uint64_t key = keys.back();
+    for (int i = (int) keys.size() - 3; i >= 0; i -= 2) {
+        if (keys[i] == key) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Reading the clock is slow next to searching a node, so only do it every 1024 nodes
+void Search::checkLimits() {
+    if ((limits.nodes && nodes >= limits.nodes) ||
+        ((nodes & 1023u) == 0 && limits.timeMs && elapsedMs() >= limits.timeMs)) {
+        stopped = true;
+    }
+}
+
+int64_t Search::elapsedMs() const {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - startTime).count();
+}
@@ -0,0 +1,206 @@
+#ifndef CHESSAMATEUR3_SEARCH_H
+#define CHESSAMATEUR3_SEARCH_H
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <vector>
+#include <stdint.h>
+#include "GameState.h"
+#include "Move.h"
+#include "MoveOrdering.h"
+#include "Nnue.h"
+#include "TranspositionTable.h"
+
+// Chooses moves with a negamax alpha-beta search. Each iteration of the deepening loop searches one ply
+// deeper than the last, using its score to narrow the window (aspiration) and its best moves (through the
+// transposition table) to search the best line first. Moves after the first at each node are searched
+// with a null window to prove they're no better (principal variation search), and only re-searched if not.
+// Once the depth runs out, captures are played out until the position is quiet (quiescence search), so a
+// line isn't scored in the middle of an exchange. Moves are tried in the order MoveOrdering predicts is best.
+// Away from the principal variation, the search also prunes and reduces lines that are unlikely to matter
+// (see SearchOptions)
+
+// The tree is walked with an explicit stack of nodes rather than by recursion, so a search can also be run a
+// slice at a time (startSearch, then searchStep until it returns false) and pick up where it left off. That
+// keeps a single-threaded caller, like the browser's main thread, free between slices. Quiescence searches
+// are small and still recursive, so they always finish within the slice that starts them
+
+// With more than one thread, helper threads search the same root alongside the main one and share what they
+// find through the transposition table (lazy SMP). They spread out by starting at different depths and by
+// racing each other to different parts of the tree. Only the main thread's result is reported
+
+// Positions are evaluated with the piece-square tables, or with a neural network if one is set (see Nnue)
+
+// Scores are in centipawns from the point of view of the side to move
+
+struct SearchLimits {
+    static constexpr int MAX_DEPTH = 64;
+
+    int depth{MAX_DEPTH};
+    uint64_t nodes{0}; // 0 for no limit
+    int64_t timeMs{0}; // 0 for no limit
+};
+
+// Switches for parts of the search, so their effect on the tree can be measured
+struct SearchOptions {
+    bool moveOrdering{true}; // If false, only the hash move is tried early and the rest go in generation order
+    bool nullMove{true}; // Cut nodes where passing the turn still fails high in a reduced search
+    bool lateMoveReductions{true}; // Search quiet moves late in the ordering less deeply, unless they look good
+    bool reverseFutility{true}; // Cut nodes near the leaves whose evaluation is far above beta
+    bool futility{true}; // Skip quiet moves near the leaves when the evaluation is far below alpha
+};
+
+struct SearchResult {
+    Move bestMove; // A default Move if there are no legal moves
+    int score;
+    int depth; // Of the last completed iteration
+    uint64_t nodes; // Searched by every thread. Reports from onIteration only count the main thread's
+    int64_t timeMs;
+    std::vector<Move> pv;
+};
+
+class Search {
+public:
+    static constexpr int MAX_PLY = MoveOrdering::MAX_PLY;
+    static constexpr int INFINITE_SCORE = 32001;
+    static constexpr int MATE_SCORE = 32000; // Being mated now. Mate in n plies scores MATE_SCORE - n
+    static constexpr int MATE_BOUND = MATE_SCORE - MAX_PLY; // Scores beyond this are mates
+
+    explicit Search(TranspositionTable& tt);
+
+    // Searches root until a limit is reached or stop is called, and returns the result of the deepest completed
+    // iteration. history holds the keys of the positions played before root, for spotting repetitions
+    SearchResult think(const GameState& root, const SearchLimits& limits,
+                       const std::vector<uint64_t>& history = {});
+
+    // The same search as think, but run by calling searchStep until it returns false. Each step searches until
+    // it has used up budgetUs microseconds or budgetNodes nodes (0 for no budget) and returns whether the search
+    // has more to do. The limits still apply across all steps, with time counted from startSearch.
+    // Helper threads aren't used
+    void startSearch(const GameState& root, const SearchLimits& limits, const std::vector<uint64_t>& history = {});
+    bool searchStep(int64_t budgetUs, uint64_t budgetNodes = 0);
+
+    // The deepest completed iteration of the current or last search, with nodes and time so far
+    SearchResult currentResult() const;
+
+    // Ends the current search early. Safe to call from another thread
+    void stop() { stopped = true; }
+
+    // Total threads to search with, including the one calling think. Takes effect from the next search
+    void setThreads(unsigned count);
+    unsigned getThreads() const { return (unsigned) helpers.size() + 1; }
+
+    // Called after each completed iteration, eg to report progress
+    std::function<void(const SearchResult&)> onIteration;
+
+    SearchOptions options;
+
+    // Forgets what was learned in earlier searches, eg for a new game. The transposition table is cleared separately
+    void clear();
+
+    // Evaluates with network instead of the piece-square tables, or with the tables again if null. The network must
+    // outlive the search, and is shared with the helper threads
+    void setNetwork(const Nnue* network);
+
+    // How well moves were ordered in the last search
+    const MoveOrdering::Stats& orderingStats() const { return ordering.stats(); }
+
+    // Material and piece placement for the side to act, blended between middlegame and endgame by phase. GameState
+    // keeps both up to date, so this is only a few operations
+    static int evaluate(const GameState& gs);
+
+private:
+    // A node of the main search, kept in nodeStack instead of on the call stack. state says where to pick up:
+    // ENTER for a new node, AFTER_NULL_MOVE once its null move search returns, NEXT_MOVE to search its next
+    // move, and AFTER_CHILD once a search of the current move returns. A move may be searched up to three
+    // times (reduced, null window, full window); probe says which is running
+    struct Node {
+        enum State : uint8_t { ENTER, AFTER_NULL_MOVE, NEXT_MOVE, AFTER_CHILD };
+        enum Probe : uint8_t { FULL_WINDOW, REDUCED, NULL_WINDOW };
+
+        int depth, ply, alpha, beta, originalAlpha;
+        State state;
+        Probe probe;
+        bool pvNode, inCheck, futile;
+        int eval;
+        uint64_t key;
+        Move hashMove;
+
+        MoveList moves;
+        int scores[MoveList::CAPACITY];
+        StagedMovePicker picker;
+        Move previous; // The move that led here
+
+        int best;
+        Move bestMove;
+        MoveList quietsTried;
+
+        // The move being searched
+        Move move;
+        int moveScore, moveNumber, reduction;
+        bool quiet;
+    };
+
+    TranspositionTable& tt;
+    GameState gs;
+    SearchLimits limits;
+    std::atomic<bool> stopped{false};
+    uint64_t nodes{0};
+    std::chrono::steady_clock::time_point startTime;
+
+    MoveOrdering ordering;
+
+    // With a network, the accumulator of each ply on the way to the current node. Most nodes are never evaluated,
+    // so they're only brought up to date when one is, from the piece changes of the moves leading to it
+    const Nnue* network{nullptr};
+    std::vector<Nnue::Accumulator> accumulators; // Indexed by ply
+    GameState::MoveChanges plyChanges[MAX_PLY]; // The changes made by the move to each ply
+    int accumulatedPly{0}; // The accumulators up to here are current
+
+    std::vector<std::unique_ptr<Search>> helpers;
+
+    std::vector<uint64_t> keys; // Positions from the start of the game to the current node
+    Move moveStack[MAX_PLY]; // The move made at each ply on the way to the current node. Default for a null move
+    Move pv[MAX_PLY][MAX_PLY];
+    int pvLength[MAX_PLY];
+
+    Node nodeStack[MAX_PLY]; // Indexed by ply. The quiescence search borrows the lists of the nodes it's in place of
+    int nodeCount{0};
+    bool childReturned{false}; // If so, the top node is waiting on childScore
+    int childScore{0};
+
+    // The iterative deepening loop's state between steps
+    SearchResult result;
+    int iterationDepth{0};
+    int windowAlpha{0}, windowBeta{0}, windowDelta{0}; // The aspiration window
+    bool finished{true};
+
+    void prepare(const GameState& root, const SearchLimits& searchLimits, const std::vector<uint64_t>& history,
+                 int firstDepth);
+    void startIteration();
+    void searchRoot();
+    void finishRoot(int score);
+
+    // The steps of a node. Each either pushes a child, moves on to a later state, or returns with finishNode
+    void pushNode(int depth, int ply, int alpha, int beta);
+    void enterNode(Node& node);
+    void startMoves(Node& node, bool canPrune);
+    void finishMoves(Node& node);
+    void searchNextMove(Node& node);
+    void afterNullMove(Node& node, int score);
+    void afterChild(Node& node, int score);
+    void finishNode(int score);
+    bool tryNullMove(Node& node);
+
+    void moveMade(int ply);
+    int evaluateAt(int ply);
+
+    int quiesce(int ply, int alpha, int beta);
+    bool isRepetition() const;
+    void checkLimits();
+    int64_t elapsedMs() const;
+};
+
+#endif //CHESSAMATEUR3_SEARCH_H
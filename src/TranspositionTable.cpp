@@ -0,0 +1,144 @@
+#include <algorithm>
+
+#include "TranspositionTable.h"
+
+TranspositionTable::TranspositionTable(size_t megabytes) {
+    resize(megabytes);
+}
+
+void TranspositionTable::resize(size_t megabytes) {
+    size_t count = 1;
+    while (count * 2 * sizeof(Bucket) <= megabytes * 1024 * 1024) {
+        count *= 2;
+    }
+
+    // new doesn't have to honour alignas(64) before C++17, so line the buckets up by hand
+    memory.reset(new char[count * sizeof(Bucket) + alignof(Bucket)]);
+    uintptr_t address = reinterpret_cast<uintptr_t>(memory.get());
+    buckets = reinterpret_cast<Bucket*>((address + alignof(Bucket) - 1) & ~(uintptr_t) (alignof(Bucket) - 1));
+    mask = count - 1;
+    clear();
+}
+
+void TranspositionTable::clear() {
+    for (size_t b = 0; b <= mask; b++) {
+        for (Entry& e : buckets[b].entries) {
+            e.check.store(0, std::memory_order_relaxed);
+            e.data.store(0, std::memory_order_relaxed);
+        }
+    }
+    age = 0;
+
+    for (Counters& c : counters) {
+        c.probes.store(0, std::memory_order_relaxed);
+        c.hits.store(0, std::memory_order_relaxed);
+        c.stores.store(0, std::memory_order_relaxed);
+        c.overwrites.store(0, std::memory_order_relaxed);
+    }
+}
+
+// Threads take slots in the order they first count anything
+unsigned TranspositionTable::counterSlot() {
+    static std::atomic<unsigned> nextSlot{0};
+    thread_local unsigned slot = nextSlot.fetch_add(1, std::memory_order_relaxed) % COUNTER_SLOTS;
+    return slot;
+}
+
+void TranspositionTable::newSearch() {
+    age = (age + 1) & AGE_MASK;
+}
+
+uint64_t TranspositionTable::pack(Move move, int score, int depth, Bound bound, unsigned age) {
+    return (uint64_t) move.pack() |
+           (uint64_t) (uint16_t) (int16_t) score << 16u |
+           (uint64_t) std::min(std::max(depth, 0), 255) << 32u |
+           (uint64_t) bound << 40u |
+           (uint64_t) age << 42u;
+}
+
+TranspositionTable::Stats TranspositionTable::stats() const {
+    Stats total{0, 0, 0, 0};
+    for (const Counters& c : counters) {
+        total.probes += c.probes.load(std::memory_order_relaxed);
+        total.hits += c.hits.load(std::memory_order_relaxed);
+        total.stores += c.stores.load(std::memory_order_relaxed);
+        total.overwrites += c.overwrites.load(std::memory_order_relaxed);
+    }
+    return total;
+}
+
+bool TranspositionTable::probe(uint64_t key, Hit& hit) {
+    Counters& counted = counters[counterSlot()];
+    counted.probes.fetch_add(1, std::memory_order_relaxed);
+
+    for (const Entry& e : buckets[key & mask].entries) {
+        uint64_t data = e.data.load(std::memory_order_relaxed);
+        uint64_t check = e.check.load(std::memory_order_relaxed);
+        if ((check ^ data) == key && boundOf(data) != NO_BOUND) {
+            counted.hits.fetch_add(1, std::memory_order_relaxed);
+            hit.move = Move::unpack((uint16_t) data);
+            hit.score = (int16_t) (data >> 16u);
+            hit.depth = depthOf(data);
+            hit.bound = boundOf(data);
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void TranspositionTable::store(uint64_t key, int depth, Bound bound, int score, Move move) {
+    Entry* entries = buckets[key & mask].entries;
+    Entry* victim = nullptr;
+    int victimWorth = 0;
+
+    // Reuse the position's own entry or an empty one. Failing that, replace the entry that's worth the least:
+    // shallow entries save less work, and entries from earlier searches are less likely to be needed again.
+    // Buckets fill from the front and entries are never removed, so a position's own entry comes before any empty one.
+    // A torn entry just looks like some other position's, and gets replaced on its merits
+    bool overwrite = false;
+    for (int i = 0; i < BUCKET_SIZE; i++) {
+        Entry& e = entries[i];
+        uint64_t data = e.data.load(std::memory_order_relaxed);
+        uint64_t entryKey = e.check.load(std::memory_order_relaxed) ^ data;
+        if (entryKey == key || boundOf(data) == NO_BOUND) {
+            if (move == Move{} && entryKey == key) {
+                move = Move::unpack((uint16_t) data);
+            }
+            victim = &e;
+            overwrite = false;
+            break;
+        }
+
+        int worth = depthOf(data) - 8 * (int) ((age - ageOf(data)) & AGE_MASK);
+        if (!victim || worth < victimWorth) {
+            victim = &e;
+            victimWorth = worth;
+            overwrite = true;
+        }
+    }
+
+    Counters& counted = counters[counterSlot()];
+    if (overwrite) {
+        counted.overwrites.fetch_add(1, std::memory_order_relaxed);
+    }
+    counted.stores.fetch_add(1, std::memory_order_relaxed);
+
+    uint64_t data = pack(move, score, depth, bound, age);
+    victim->data.store(data, std::memory_order_relaxed);
+    victim->check.store(key ^ data, std::memory_order_relaxed);
+}
+
+int TranspositionTable::fillPermille() const {
+    size_t sample = std::min(mask + 1, (size_t) 1000);
+    size_t used = 0;
+
+    for (size_t b = 0; b < sample; b++) {
+        for (const Entry& e : buckets[b].entries) {
+            uint64_t data = e.data.load(std::memory_order_relaxed);
+            used += boundOf(data) != NO_BOUND && ageOf(data) == age;
+        }
+    }
+
+    return (int) (used * 1000 / (sample * BUCKET_SIZE));
+}
@@ -0,0 +1,108 @@
+#ifndef CHESSAMATEUR3_TRANSPOSITIONTABLE_H
+#define CHESSAMATEUR3_TRANSPOSITIONTABLE_H
+
+#include <atomic>
+#include <memory>
+#include <stdint.h>
+#include "Move.h"
+
+// Remembers search results by Zobrist key, so positions reached again (by transposition or in the next
+// iteration of a deepening search) can reuse them: the stored score may cut the search off, and the
+// stored move is the best one to try first.
+
+// Entries are grouped into buckets the size of a cache line, and a key always maps to the same bucket,
+// so a probe touches one line of memory. The number of buckets is a power of two so the low bits of the
+// key pick the bucket; the whole key is stored to verify a hit.
+
+// Any number of threads may probe and store at once without locking. Each entry stores its key XORed with
+// its data, so if two threads' writes to an entry interleave, the halves no longer match and the entry reads
+// as a miss instead of returning one position's data for another.
+
+// Example usage in a search:
+
+// TranspositionTable::Hit hit;
+// if (tt.probe(gs.getKey(), hit) && hit.depth >= depth && hit.bound == TranspositionTable::EXACT) {
+//   return hit.score;
+// }
+// ...
+// tt.store(gs.getKey(), depth, TranspositionTable::EXACT, best, bestMove);
+
+class TranspositionTable {
+public:
+    // What a stored score says about the true score: UPPER is from a node that failed low (no move
+    // reached alpha), LOWER from one that failed high (a move reached beta)
+    enum Bound : uint8_t { NO_BOUND = 0, UPPER, LOWER, EXACT };
+
+    struct Hit {
+        Move move;
+        int score;
+        int depth;
+        Bound bound;
+    };
+
+    struct Stats {
+        uint64_t probes, hits, stores, overwrites;
+
+        double hitRate() const { return probes ? (double) hits / probes : 0; }
+    };
+
+    // Sizes are in megabytes, rounded down to a power of two number of buckets. At least one bucket is kept
+    explicit TranspositionTable(size_t megabytes);
+
+    void resize(size_t megabytes);
+    size_t sizeInBytes() const { return (mask + 1) * sizeof(Bucket); }
+
+    // Empties the table and resets the statistics. Not safe while other threads use the table, nor are resize
+    // and newSearch
+    void clear();
+
+    // Call at the start of each search. Entries from earlier searches are replaced before current ones
+    void newSearch();
+
+    bool probe(uint64_t key, Hit& hit);
+
+    // Keeps the entry's move when storing a position again without one
+    void store(uint64_t key, int depth, Bound bound, int score, Move move);
+
+    // Summed over every thread's counters, so only exact once they've finished
+    Stats stats() const;
+
+    // Entries in use by the current search per thousand, from a sample of buckets
+    int fillPermille() const;
+
+private:
+    // data packs the move (bits 0-15), score (16-31), depth (32-39), bound (40-41) and age (42-47).
+    // check is the key XORed with data
+    struct Entry {
+        std::atomic<uint64_t> check;
+        std::atomic<uint64_t> data;
+    };
+
+    static constexpr int BUCKET_SIZE = 4;
+    static constexpr unsigned AGE_MASK = 63;
+    static constexpr unsigned COUNTER_SLOTS = 16;
+
+    struct alignas(64) Bucket {
+        Entry entries[BUCKET_SIZE];
+    };
+
+    std::unique_ptr<char[]> memory; // Over-allocated so the buckets can start on a cache line
+    Bucket* buckets{nullptr};
+    size_t mask{0};
+    unsigned age{0};
+
+    // Each on a line of its own. Threads count in their own slot (see counterSlot), since threads probing at every
+    // node would otherwise all be writing to one line. Slots are only shared beyond COUNTER_SLOTS threads
+    struct alignas(64) Counters {
+        std::atomic<uint64_t> probes{0}, hits{0}, stores{0}, overwrites{0};
+    } counters[COUNTER_SLOTS];
+
+    static unsigned counterSlot();
+
+    static uint64_t pack(Move move, int score, int depth, Bound bound, unsigned age);
+    static Bound boundOf(uint64_t data) { return (Bound) ((data >> 40u) & 3u); }
+    static int depthOf(uint64_t data) { return (int) ((data >> 32u) & 0xffu); }
+    static unsigned ageOf(uint64_t data) { return (unsigned) (data >> 42u) & AGE_MASK; }
+};
+
+#endif //CHESSAMATEUR3_TRANSPOSITIONTABLE_H
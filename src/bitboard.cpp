@@ -0,0 +1,183 @@
+#include "bitboard.h"
+// Leaper attack tables and rays are built by the compiler, so they are ready before any static GameState
+// is constructed. Slider attack tables are too large for that, and are filled in by initBitboards
+
+namespace CA3 {
+    namespace {
+        // File and rank steps for each direction, in Direction order
+        // Ranks are counted down the board here, matching square numbering (south is +1)
+        constexpr int fileSteps[8] = {0, 0, 1, -1, 1, -1, -1, 1};
+        constexpr int rankSteps[8] = {1, -1, 0, 0, 1, -1, 1, -1};
+
+        constexpr bool onBoard(int file, int rank) { return file >= 0 && file < 8 && rank >= 0 && rank < 8; }
+
+        // Bit for the square offset from s, or an empty set if that's off the board
+        constexpr Bitboard offsetBit(Square s, int fileOffset, int rankOffset) {
+            int file = s % 8 + fileOffset;
+            int rank = s / 8 + rankOffset;
+            return onBoard(file, rank) ? squareBit((Square) (file + 8 * rank)) : EMPTY_BOARD;
+        }
+
+        constexpr BitboardTables makeTables() {
+            BitboardTables t{};
+
+            for (Square s = 0; s < 64; s++) {
+                for (Direction d = ALLDIR_START; d <= ALLDIR_END; d++) {
+                    for (int i = 1; i < 8; i++) {
+                        t.rays[d][s] |= offsetBit(s, fileSteps[d] * i, rankSteps[d] * i);
+                    }
+
+                    t.king[s] |= offsetBit(s, fileSteps[d], rankSteps[d]);
+                }
+
+                t.knight[s] = offsetBit(s, 1, 2) | offsetBit(s, 2, 1) | offsetBit(s, 2, -1) | offsetBit(s, 1, -2) |
+                              offsetBit(s, -1, -2) | offsetBit(s, -2, -1) | offsetBit(s, -2, 1) | offsetBit(s, -1, 2);
+
+                // White pawns move toward lower squares, black pawns toward higher ones
+                t.pawn[colorIndex(WHITE)][s] = offsetBit(s, -1, -1) | offsetBit(s, 1, -1);
+                t.pawn[colorIndex(BLACK)][s] = offsetBit(s, -1, 1) | offsetBit(s, 1, 1);
+            }
+
+            // Walking each ray out from 'from' reaches every square it relates to, collecting the squares between
+            // on the way. The line is the ray and its opposite (directions come in opposite pairs)
+            for (Square from = 0; from < 64; from++) {
+                for (Square to = 0; to < 64; to++) {
+                    int files = from % 8 - to % 8, ranks = from / 8 - to / 8;
+                    files = files < 0 ? -files : files;
+                    ranks = ranks < 0 ? -ranks : ranks;
+                    t.distance[from][to] = (uint8_t) (files > ranks ? files : ranks);
+                    t.direction[from][to] = INVALID_DIRECTION;
+                }
+
+                for (Direction d = ALLDIR_START; d <= ALLDIR_END; d++) {
+                    Bitboard line = t.rays[d][from] | t.rays[d ^ 1u][from] | squareBit(from);
+                    Bitboard between = EMPTY_BOARD;
+                    for (int i = 1; i < 8; i++) {
+                        Bitboard bit = offsetBit(from, fileSteps[d] * i, rankSteps[d] * i);
+                        if (!bit) {
+                            break;
+                        }
+
+                        Square to = lsb(bit);
+                        t.direction[from][to] = d;
+                        t.between[from][to] = between;
+                        t.line[from][to] = line;
+                        between |= bit;
+                    }
+                }
+            }
+
+            return t;
+        }
+    }
+
+    constexpr BitboardTables bitboardTables = makeTables();
+
+    Magic rookMagics[64];
+    Magic bishopMagics[64];
+
+    namespace {
+        // Every square's slice is 2^(bits in its mask) entries
+        Bitboard rookTable[0x19000];
+        Bitboard bishopTable[0x1480];
+
+        // Attacks found by walking each ray, used to fill the magic tables
+        Bitboard slowAttacks(Square s, Bitboard occupied, Direction first, Direction last) {
+            Bitboard attacks = EMPTY_BOARD;
+            for (Direction d = first; d <= last; d++) {
+                attacks |= rayAttacks(d, s, occupied);
+            }
+            return attacks;
+        }
+
+        // xorshift64* seeded per rank, so the same magics are found on every run.
+        // The seeds were picked by trying the first few thousand and keeping whichever found magics fastest
+        class MagicRandom {
+        public:
+            explicit MagicRandom(uint64_t seed) : state{seed} {}
+
+            uint64_t next() {
+                state ^= state >> 12u;
+                state ^= state << 25u;
+                state ^= state >> 27u;
+                return state * 2685821657736338717ull;
+            }
+
+            // Magics with few set bits are found much faster
+            uint64_t sparse() { return next() & next() & next(); }
+
+        private:
+            uint64_t state;
+        };
+
+        constexpr uint64_t rankSeeds[8] = {728, 2985, 110, 2501, 1289, 2821, 1699, 255};
+
+        void initMagics(Magic magics[], Bitboard table[], Direction first, Direction last) {
+            static Bitboard occupancies[4096], reference[4096];
+            static unsigned epoch[4096], attempt = 0;
+            Bitboard* slice = table;
+
+            for (Square s = 0; s < 64; s++) {
+                Magic& m = magics[s];
+                MagicRandom random{rankSeeds[s / 8]};
+
+                // A blocker on the last square of a ray doesn't change which squares are attacked
+                m.mask = EMPTY_BOARD;
+                for (Direction d = first; d <= last; d++) {
+                    Bitboard ray = rayFrom(d, s);
+                    if (ray) {
+                        m.mask |= ray ^ squareBit(dirIncrement(d) > 0 ? msb(ray) : lsb(ray));
+                    }
+                }
+                m.shift = (unsigned) (64 - popCount(m.mask));
+                m.attacks = slice;
+
+                // Enumerate every subset of the mask with the carry-rippler trick
+                int size = 0;
+                Bitboard subset = EMPTY_BOARD;
+                do {
+                    occupancies[size] = subset;
+                    reference[size] = slowAttacks(s, subset, first, last);
+                    size++;
+                    subset = (subset - m.mask) & m.mask;
+                } while (subset);
+
+                // Try random magics until one maps every subset to an index holding its attacks.
+                // epoch marks which entries were written during the current attempt, so nothing needs clearing
+                for (int i = 0; i < size;) {
+                    do {
+                        m.magic = random.sparse();
+                    } while (popCount((m.mask * m.magic) >> 56u) < 6);
+
+                    attempt++;
+                    for (i = 0; i < size; i++) {
+                        unsigned index = m.index(occupancies[i]);
+                        if (epoch[index] < attempt) {
+                            epoch[index] = attempt;
+                            slice[index] = reference[i];
+                        } else if (slice[index] != reference[i]) {
+                            break;
+                        }
+                    }
+                }
+
+                slice += size;
+            }
+        }
+
+        struct BitboardInitializer {
+            BitboardInitializer() { initBitboards(); }
+        } initializer;
+    }
+
+    void initBitboards() {
+        static bool initialized = false;
+        if (initialized) {
+            return;
+        }
+
+        initMagics(rookMagics, rookTable, RANKFILE_START, RANKFILE_END);
+        initMagics(bishopMagics, bishopTable, DIAGONAL_START, DIAGONAL_END);
+        initialized = true;
+    }
+}
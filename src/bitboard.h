@@ -0,0 +1,150 @@
+#ifndef CHESSAMATEUR3_BITBOARD_H
+#define CHESSAMATEUR3_BITBOARD_H
+
+#include "logistics.h"
+
+// Bitboards are sets of squares packed into 64 bits: bit s is set if square s is in the set
+// Square numbering is the same as everywhere else (0 is a8, 63 is h1), so shifting left by 8 moves a set south
+
+// Example usage: visiting the squares a knight on square 40 attacks
+
+// for(Bitboard b = knightAttacks(40); b; ) {
+//   Square to = popLsb(b);
+//   ...
+// }
+
+namespace CA3 {
+    typedef uint64_t Bitboard;
+
+    constexpr Bitboard EMPTY_BOARD = 0;
+    constexpr Bitboard FILE_A = 0x0101'0101'0101'0101ull;
+    constexpr Bitboard FILE_H = FILE_A << 7u;
+    constexpr Bitboard RANK_8 = 0xffull;
+    constexpr Bitboard RANK_1 = RANK_8 << 56u;
+
+    constexpr Bitboard squareBit(Square s) { return 1ull << s; }
+
+    constexpr bool contains(Bitboard b, Square s) { return (b >> s) & 1u; }
+
+    constexpr int popCount(Bitboard b) { return __builtin_popcountll(b); }
+
+    // Lowest and highest squares in a non-empty set
+    constexpr Square lsb(Bitboard b) { return (Square) __builtin_ctzll(b); }
+
+    constexpr Square msb(Bitboard b) { return (Square) (63 - __builtin_clzll(b)); }
+
+    // Removes the lowest square from a non-empty set and returns it
+    inline Square popLsb(Bitboard& b) {
+        Square s = lsb(b);
+        b &= b - 1;
+        return s;
+    }
+
+    // Precomputed attack sets. These are best accessed through the functions below
+    struct BitboardTables {
+        Bitboard rays[8][64]; // All squares in a direction from a square, not including the square itself
+        Bitboard knight[64];
+        Bitboard king[64];
+        Bitboard pawn[2][64]; // Indexed by colorIndex
+
+        // Relations between pairs of squares, indexed [from][to]
+        Direction direction[64][64]; // INVALID_DIRECTION unless to is on a ray from from
+        Bitboard between[64][64]; // Squares strictly between two squares on a ray, otherwise empty
+        Bitboard line[64][64]; // The whole rank, file or diagonal through two squares on a ray, otherwise empty
+        uint8_t distance[64][64]; // King steps from one square to the other
+    };
+
+    extern const BitboardTables bitboardTables;
+
+    // Fancy magic lookup for sliders: the blockers on a square's rays are hashed by a multiply and shift
+    // into an index into that square's slice of a shared attack table
+    struct Magic {
+        Bitboard mask; // Squares whose occupancy matters: the rays without their final edge square
+        Bitboard magic;
+        const Bitboard* attacks;
+        unsigned shift;
+
+        unsigned index(Bitboard occupied) const { return (unsigned) (((occupied & mask) * magic) >> shift); }
+    };
+
+    extern Magic rookMagics[64];
+    extern Magic bishopMagics[64];
+
+    // Finds the magics and fills their attack tables. This runs during static initialization, but is also
+    // called by GameState's constructor in case a static GameState is constructed first. Safe to call repeatedly
+    void initBitboards();
+
+    inline Bitboard rayFrom(Direction d, Square s) { return bitboardTables.rays[d][s]; }
+
+    inline Bitboard knightAttacks(Square s) { return bitboardTables.knight[s]; }
+
+    inline Bitboard kingAttacks(Square s) { return bitboardTables.king[s]; }
+
+    // Squares a pawn of color c on square s attacks
+    inline Bitboard pawnAttacks(Square s, Color c) { return bitboardTables.pawn[colorIndex(c)][s]; }
+
+    // Squares attacked in direction d from s, up to and including the first occupied square
+    // Directions with a positive increment run toward higher squares, so their nearest blocker is the lowest one
+    inline Bitboard rayAttacks(Direction d, Square s, Bitboard occupied) {
+        Bitboard ray = rayFrom(d, s);
+        Bitboard blockers = ray & occupied;
+        if (blockers) {
+            ray ^= rayFrom(d, dirIncrement(d) > 0 ? lsb(blockers) : msb(blockers));
+        }
+        return ray;
+    }
+
+    inline Bitboard rookAttacks(Square s, Bitboard occupied) {
+        const Magic& m = rookMagics[s];
+        return m.attacks[m.index(occupied)];
+    }
+
+    inline Bitboard bishopAttacks(Square s, Bitboard occupied) {
+        const Magic& m = bishopMagics[s];
+        return m.attacks[m.index(occupied)];
+    }
+
+    inline Bitboard queenAttacks(Square s, Bitboard occupied) {
+        return rookAttacks(s, occupied) | bishopAttacks(s, occupied);
+    }
+
+    // Squares attacked by the piece p standing on s
+    inline Bitboard pieceAttacks(Piece p, Square s, Bitboard occupied) {
+        switch (pieceType(p)) {
+            case PIECE_PAWN:
+                return pawnAttacks(s, pieceColor(p));
+            case PIECE_KNIGHT:
+                return knightAttacks(s);
+            case PIECE_BISHOP:
+                return bishopAttacks(s, occupied);
+            case PIECE_ROOK:
+                return rookAttacks(s, occupied);
+            case PIECE_QUEEN:
+                return queenAttacks(s, occupied);
+            case PIECE_KING:
+                return kingAttacks(s);
+            default:
+                return EMPTY_BOARD;
+        }
+    }
+
+    // Squares strictly between from and to along direction d (to must lie in direction d from from)
+    inline Bitboard squaresBetween(Square from, Square to, Direction d) {
+        return rayFrom(d, from) & ~rayFrom(d, to) & ~squareBit(to);
+    }
+
+    // The same, looked up. Empty if from and to don't share a rank, file or diagonal
+    inline Bitboard squaresBetween(Square from, Square to) { return bitboardTables.between[from][to]; }
+
+    // The direction from from to to, or INVALID_DIRECTION if it's none of N, E, S, W, NE, NW, SE, SW
+    inline Direction getDirection(Square from, Square to) { return bitboardTables.direction[from][to]; }
+
+    // The rank, file or diagonal through a and b, edge to edge, or an empty set if they aren't on one.
+    // c is in line with a and b if lineThrough(a, b) contains it
+    inline Bitboard lineThrough(Square a, Square b) { return bitboardTables.line[a][b]; }
+
+    // The number of king moves between two squares (Chebyshev distance)
+    inline int squareDistance(Square a, Square b) { return bitboardTables.distance[a][b]; }
+}
+
+#endif //CHESSAMATEUR3_BITBOARD_H
@@ -168,32 +168,4 @@ namespace CA3 {
             51, INVALID_SQUARE, 51, 59, 53, 61, 52, INVALID_SQUARE, 52, 60, 54, 62, 53, INVALID_SQUARE, 53, 61, 55, 63,
             54, INVALID_SQUARE, 54, 62, 55, 64
     };
-
-    // Returns the direction between two squares, or INVALID_DIR if it's none of N, E, S, W, NE, NW, SE, SW
-    Direction getDirection(Square from, Square to) {
-        int dist = from - to;
-
-        // Multiple of 8 is N, of -8 is S (wrapping impossible)
-        if (dist % 8 == 0) {
-            return dist > 0 ? NORTH : SOUTH;
-        }
-
-        // Must check vertical/horizontal distance to prevent wrapping
-        int vDist = verticalDistance(from, to);
-        if (vDist == horizontalDistance(from, to)) {
-            // Multiple of 7 is NE, -7 is SW
-            if (dist % 7 == 0) {
-                return dist > 0 ? NORTHEAST : SOUTHWEST;
-            }
-
-            // Multiple of 9 is NW, -9 is SE
-            if (dist % 9 == 0) {
-                return dist > 0 ? NORTHWEST : SOUTHEAST;
-            }
-        } else if (vDist == 0 && dist < 8) { // Dist of 1-7 is E if negative, W if positive
-            return dist < 0 ? EAST : WEST;
-        }
-
-        return INVALID_DIRECTION;
-    }
 }
\ No newline at end of file
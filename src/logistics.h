@@ -160,9 +160,6 @@ namespace CA3 {
     constexpr Square squareBehind(Square s, Color c) {
         return c == WHITE ? s + 8 : s - 8;
     }
-
-    // Returns the direction between two squares, or INVALID_DIR if it's none of N, E, S, W, NE, NW, SE, SW
-    Direction getDirection(Square from, Square to);
 }
 
 #endif //CHESSAMATEUR3_LOGISTICS_H
@@ -59,11 +59,31 @@ namespace CA3 {
 
     constexpr PieceCharacteristic pieceType(Piece p) { return p & MASK_PIECE; }
 
+    // Only meaningful for non-empty pieces: NO_PIECE reports WHITE
     constexpr Color pieceColor(Piece p) { return p & PIECE_BLACK ? BLACK : WHITE; }
 
     constexpr Color enemyColor(Color c) { return c == WHITE ? BLACK : WHITE; }
 
     constexpr bool oppositeColors(Piece p1, Piece p2) { return (p1 & MASK_COLOR) != (p2 & MASK_COLOR); }
 
+    // Indices for tables kept per color or per piece type, eg bitboards
+    constexpr int PAWN_INDEX = 0;
+    constexpr int KNIGHT_INDEX = 1;
+    constexpr int BISHOP_INDEX = 2;
+    constexpr int ROOK_INDEX = 3;
+    constexpr int QUEEN_INDEX = 4;
+    constexpr int KING_INDEX = 5;
+
+    // BLACK is 0 and WHITE is 1
+    constexpr int colorIndex(Color c) { return c >> 1u; }
+
+    // Only valid for non-empty pieces or piece types
+    constexpr int typeIndex(PieceCharacteristic type) { return __builtin_ctz(type & MASK_PIECE) - 2; }
+
+    // Material values in centipawns, indexed by typeIndex. Kings can't be traded, so they're worth nothing here
+    constexpr int PIECE_VALUES[6] = {100, 320, 330, 500, 900, 0};
+
+    constexpr int pieceValue(Piece p) { return p == NO_PIECE ? 0 : PIECE_VALUES[typeIndex(p)]; }
+
 }
 #endif //CHESSAMATEUR3_PIECE_H
@@ -0,0 +1,50 @@
+#ifndef CHESSAMATEUR3_PST_H
+#define CHESSAMATEUR3_PST_H
+
+#include <algorithm>
+#include "piece.h"
+#include "logistics.h"
+
+// Piece-square tables: what each piece is worth on each square, material included, once for the middlegame and
+// once for the endgame. A position's score is the sum over its pieces, so like the Zobrist key, GameState keeps
+// it up to date as pieces come and go. The game phase is counted the same way, from the non-pawn material left,
+// and blends the two scores (a tapered evaluation): kings should shelter while queens are about and come out once
+// they're gone, and passed pawns grow more valuable as the board empties.
+
+// The values are PeSTO's, tuned by Ronald Friederich for his engine Rofchade
+
+namespace CA3 {
+    // Scores are from white's point of view
+    struct TaperedScore {
+        int mg, eg;
+    };
+
+    constexpr TaperedScore operator + (TaperedScore a, TaperedScore b) { return {a.mg + b.mg, a.eg + b.eg}; }
+    constexpr TaperedScore operator - (TaperedScore a, TaperedScore b) { return {a.mg - b.mg, a.eg - b.eg}; }
+    constexpr bool operator == (TaperedScore a, TaperedScore b) { return a.mg == b.mg && a.eg == b.eg; }
+
+    struct PieceSquareTables {
+        TaperedScore scores[2][6][64]; // Indexed by colorIndex, typeIndex and square. Black's are negative
+    };
+
+    extern const PieceSquareTables pieceSquareTables;
+
+    // How much each piece type counts towards the phase, indexed by typeIndex. MAX_PHASE is the starting material
+    constexpr int PHASE_WEIGHTS[6] = {0, 1, 1, 2, 4, 0};
+    constexpr int MAX_PHASE = 24;
+
+    inline TaperedScore pieceSquareScore(Piece p, Square s) {
+        return p == NO_PIECE ? TaperedScore{0, 0} :
+               pieceSquareTables.scores[colorIndex(pieceColor(p))][typeIndex(p)][s];
+    }
+
+    constexpr int phaseWeight(Piece p) { return p == NO_PIECE ? 0 : PHASE_WEIGHTS[typeIndex(p)]; }
+
+    // Blends the scores by phase, from all endgame at 0 to all middlegame at MAX_PHASE or more (after promotions)
+    inline int taper(TaperedScore score, int phase) {
+        phase = std::min(phase, MAX_PHASE);
+        return (score.mg * phase + score.eg * (MAX_PHASE - phase)) / MAX_PHASE;
+    }
+}
+
+#endif //CHESSAMATEUR3_PST_H
@@ -0,0 +1,42 @@
+#include "zobrist.h"
+// The keys are generated by the compiler with splitmix64 from a fixed seed, so they're the same on every
+// build and ready before any static GameState is constructed
+
+namespace CA3 {
+    namespace {
+        constexpr uint64_t splitmix64(uint64_t& state) {
+            uint64_t z = (state += 0x9e3779b97f4a7c15ull);
+            z = (z ^ (z >> 30u)) * 0xbf58476d1ce4e5b9ull;
+            z = (z ^ (z >> 27u)) * 0x94d049bb133111ebull;
+            return z ^ (z >> 31u);
+        }
+
+        constexpr ZobristKeys makeKeys() {
+            ZobristKeys k{};
+            uint64_t state = 0x43484553534d4154ull;
+
+            for (int p = 0; p < 12; p++) {
+                for (Square s = 0; s < 64; s++) {
+                    k.pieces[p][s] = splitmix64(state);
+                }
+            }
+
+            k.blackToAct = splitmix64(state);
+
+            for (int slot = 0; slot < 4; slot++) {
+                for (Square s = 0; s < 64; s++) {
+                    k.castle[slot][s] = splitmix64(state);
+                }
+                k.castle[slot][INVALID_SQUARE] = 0;
+            }
+
+            for (int file = 0; file < 8; file++) {
+                k.enPassant[file] = splitmix64(state);
+            }
+
+            return k;
+        }
+    }
+
+    constexpr ZobristKeys zobristKeys = makeKeys();
+}
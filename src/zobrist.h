@@ -0,0 +1,40 @@
+#ifndef CHESSAMATEUR3_ZOBRIST_H
+#define CHESSAMATEUR3_ZOBRIST_H
+
+#include <stdint.h>
+#include "piece.h"
+#include "logistics.h"
+
+// Zobrist keys: each feature of a position (a piece on a square, the side to move, a castling right,
+// an en passant file) has a random 64 bit number, and a position's key is the XOR of its features' numbers.
+// Since XOR is its own inverse, GameState updates the key as pieces come and go instead of recomputing it
+
+namespace CA3 {
+    struct ZobristKeys {
+        uint64_t pieces[12][64]; // Indexed by zobristPieceIndex
+        uint64_t blackToAct;
+        uint64_t castle[4][65]; // Indexed by castling slot and rook square. INVALID_SQUARE (no right) is 0
+        uint64_t enPassant[8]; // Indexed by file
+    };
+
+    extern const ZobristKeys zobristKeys;
+
+    // Castling slots, one per rook that may castle
+    constexpr int WHITE_EAST_CASTLE = 0;
+    constexpr int WHITE_WEST_CASTLE = 1;
+    constexpr int BLACK_EAST_CASTLE = 2;
+    constexpr int BLACK_WEST_CASTLE = 3;
+
+    constexpr int zobristPieceIndex(Piece p) { return 6 * colorIndex(pieceColor(p)) + typeIndex(p); }
+
+    // NO_PIECE has no key, so emptying or filling a square is the same XOR
+    inline uint64_t pieceKey(Piece p, Square s) {
+        return p == NO_PIECE ? 0 : zobristKeys.pieces[zobristPieceIndex(p)][s];
+    }
+
+    inline uint64_t castleKey(int slot, Square rook) { return zobristKeys.castle[slot][rook]; }
+
+    inline uint64_t enPassantKey(Square s) { return s == INVALID_SQUARE ? 0 : zobristKeys.enPassant[s % 8]; }
+}
+
+#endif //CHESSAMATEUR3_ZOBRIST_H
@@ -0,0 +1,192 @@
+#include <algorithm>
+#include "catch.hpp"
+#include "../src/bitboard.h"
+#include "../src/GameState.h"
+
+// Board reference:
+// 0  1  2  3  4  5  6  7
+// 8  9  10 11 12 13 14 15
+// 16 17 18 19 20 21 22 23
+// 24 25 26 27 28 29 30 31
+// 32 33 34 35 36 37 38 39
+// 40 41 42 43 44 45 46 47
+// 48 49 50 51 52 53 54 55
+// 56 57 58 59 60 61 62 63
+
+using namespace CA3;
+
+Bitboard squaresToBoard(std::initializer_list<Square> squares) {
+    Bitboard b = EMPTY_BOARD;
+    for (Square s : squares) {
+        b |= squareBit(s);
+    }
+    return b;
+}
+
+TEST_CASE("Test bit helpers") {
+    Bitboard b = squaresToBoard({3, 17, 60});
+    REQUIRE(popCount(b) == 3);
+    REQUIRE(lsb(b) == 3);
+    REQUIRE(msb(b) == 60);
+    REQUIRE(contains(b, 17));
+    REQUIRE(!contains(b, 18));
+
+    REQUIRE(popLsb(b) == 3);
+    REQUIRE(popLsb(b) == 17);
+    REQUIRE(b == squareBit(60));
+}
+
+TEST_CASE("Test attack tables") {
+    SECTION("Rays match the direction data") {
+        for (Direction dir = ALLDIR_START; dir <= ALLDIR_END; dir++) {
+            for (Square s = 0; s < 64; s++) {
+                Bitboard expected = EMPTY_BOARD;
+                Square inDir;
+                for (Square const* p = dirPtr(dir, s); (inDir = *p) != INVALID_SQUARE; p += dirIncrement(dir)) {
+                    expected |= squareBit(inDir);
+                }
+                REQUIRE(rayFrom(dir, s) == expected);
+            }
+        }
+    }
+
+    SECTION("Knight and king attacks match the knight and king data") {
+        for (Square s = 0; s < 64; s++) {
+            Bitboard knights = EMPTY_BOARD, kings = EMPTY_BOARD;
+            Square to;
+            for (Square const* p = knightPtr(s); (to = *p) != INVALID_SQUARE; ++p) {
+                knights |= squareBit(to);
+            }
+            for (Square const* p = kingPtr(s); (to = *p) != INVALID_SQUARE; ++p) {
+                kings |= squareBit(to);
+            }
+            REQUIRE(knightAttacks(s) == knights);
+            REQUIRE(kingAttacks(s) == kings);
+        }
+    }
+
+    SECTION("Pawn attacks don't wrap") {
+        REQUIRE(pawnAttacks(52, WHITE) == squaresToBoard({43, 45}));
+        REQUIRE(pawnAttacks(48, WHITE) == squaresToBoard({41}));
+        REQUIRE(pawnAttacks(15, BLACK) == squaresToBoard({22}));
+        REQUIRE(pawnAttacks(12, BLACK) == squaresToBoard({19, 21}));
+    }
+
+    SECTION("Slider attacks stop at the first blocker") {
+        // . . . . . . . .
+        // . . . . . . . .
+        // . . x . . . . .
+        // . . . . . . . .
+        // . . * . . x . .
+        // . . . . . . . .
+        // . . . . . . . .
+        // . . . . . . . .
+        Bitboard occupied = squaresToBoard({18, 37});
+        REQUIRE(rookAttacks(34, occupied) == squaresToBoard({26, 18, 42, 50, 58, 32, 33, 35, 36, 37}));
+        REQUIRE(bishopAttacks(34, occupied) == squaresToBoard({25, 16, 27, 20, 13, 6, 41, 48, 43, 52, 61}));
+        REQUIRE(queenAttacks(34, occupied) == (rookAttacks(34, occupied) | bishopAttacks(34, occupied)));
+        REQUIRE(squaresBetween(34, 37, EAST) == squaresToBoard({35, 36}));
+    }
+}
+
+TEST_CASE("Test square relations") {
+    SECTION("Every pair of squares on a ray agrees with the rays") {
+        for (Square from = 0; from < 64; from++) {
+            for (Square to = 0; to < 64; to++) {
+                Direction dir = INVALID_DIRECTION;
+                for (Direction d = ALLDIR_START; d <= ALLDIR_END; d++) {
+                    if (contains(rayFrom(d, from), to)) {
+                        dir = d;
+                    }
+                }
+
+                REQUIRE(getDirection(from, to) == dir);
+                if (dir == INVALID_DIRECTION) {
+                    REQUIRE(squaresBetween(from, to) == EMPTY_BOARD);
+                    REQUIRE(lineThrough(from, to) == EMPTY_BOARD);
+                } else {
+                    REQUIRE(getDirection(to, from) == (dir ^ 1u));
+                    REQUIRE(squaresBetween(from, to) == squaresBetween(from, to, dir));
+                    REQUIRE(squaresBetween(from, to) == squaresBetween(to, from));
+                    REQUIRE(lineThrough(from, to) == (rayFrom(dir, from) | rayFrom(dir ^ 1u, from) | squareBit(from)));
+                    REQUIRE(lineThrough(from, to) == lineThrough(to, from));
+                }
+
+                REQUIRE(squareDistance(from, to) == std::max(horizontalDistance(from, to), verticalDistance(from, to)));
+            }
+        }
+    }
+
+    SECTION("Examples") {
+        REQUIRE(getDirection(60, 4) == NORTH);
+        REQUIRE(getDirection(60, 60) == INVALID_DIRECTION);
+        REQUIRE(getDirection(56, 7) == NORTHEAST);
+        REQUIRE(getDirection(1, 18) == INVALID_DIRECTION); // A knight's move
+        REQUIRE(squaresBetween(56, 7) == squaresToBoard({49, 42, 35, 28, 21, 14}));
+        REQUIRE(squaresBetween(34, 35) == EMPTY_BOARD);
+        REQUIRE(lineThrough(35, 36) == RANK_8 << 32u);
+        REQUIRE(squareDistance(0, 63) == 7);
+        REQUIRE(squareDistance(0, 10) == 2);
+    }
+}
+
+TEST_CASE("Test magic slider attacks") {
+    // Compare against walking the rays for a spread of pseudo-random occupancies
+    uint64_t state = 0x9e3779b97f4a7c15ull;
+    for (int i = 0; i < 2000; i++) {
+        state ^= state << 13u;
+        state ^= state >> 7u;
+        state ^= state << 17u;
+        Bitboard occupied = state & (state >> 3u);
+
+        for (Square s = 0; s < 64; s++) {
+            Bitboard rook = EMPTY_BOARD, bishop = EMPTY_BOARD;
+            for (Direction dir = RANKFILE_START; dir <= RANKFILE_END; dir++) {
+                rook |= rayAttacks(dir, s, occupied);
+            }
+            for (Direction dir = DIAGONAL_START; dir <= DIAGONAL_END; dir++) {
+                bishop |= rayAttacks(dir, s, occupied);
+            }
+
+            REQUIRE(rookAttacks(s, occupied) == rook);
+            REQUIRE(bishopAttacks(s, occupied) == bishop);
+        }
+    }
+}
+
+TEST_CASE("Test GameState bitboards") {
+    GameState gs;
+
+    SECTION("Starting position") {
+        REQUIRE(gs.colorBoard(BLACK) == 0xffffull);
+        REQUIRE(gs.colorBoard(WHITE) == 0xffffull << 48u);
+        REQUIRE(gs.pieceBoard(PIECE_KING, WHITE) == squareBit(60));
+        REQUIRE(gs.pieceBoard(PIECE_PAWN, BLACK) == 0xff00ull);
+    }
+
+    SECTION("Assigning squares keeps the bitboards in sync") {
+        gs[4] = NO_PIECE;
+        gs[0] = WHITE_QUEEN;
+        REQUIRE(gs.pieceBoard(PIECE_KING, BLACK) == EMPTY_BOARD);
+        REQUIRE(gs.pieceBoard(PIECE_ROOK, BLACK) == squareBit(7));
+        REQUIRE(contains(gs.pieceBoard(PIECE_QUEEN, WHITE), 0));
+        REQUIRE(popCount(gs.occupied()) == 31);
+    }
+
+    SECTION("Moves keep the bitboards in sync") {
+        gs.makeMove({52, 36, FORCED_MARCH});
+        gs.makeMove({11, 27, FORCED_MARCH});
+        gs.makeMove({36, 27, CAPTURE});
+        REQUIRE(gs.pieceBoard(PIECE_PAWN, WHITE) == ((0xffull << 48u) ^ squareBit(52) ^ squareBit(27)));
+        REQUIRE(gs.pieceBoard(PIECE_PAWN, BLACK) == (0xff00ull ^ squareBit(11)));
+
+        gs.unmakeMove();
+        REQUIRE(contains(gs.pieceBoard(PIECE_PAWN, BLACK), 27));
+        REQUIRE(contains(gs.pieceBoard(PIECE_PAWN, WHITE), 36));
+    }
+
+    SECTION("attackersTo finds both colors") {
+        // Square 21 (f6) is attacked by the g8 knight and the e7 and g7 pawns
+        REQUIRE(gs.attackersTo(21, gs.occupied()) == squaresToBoard({6, 12, 14}));
+    }
+}
@@ -2,6 +2,7 @@
 
 #include <iostream>
 #include "../src/Game.h"
+#include "../src/Search.h"
 
 using namespace std;
 using namespace CA3;
@@ -285,12 +286,32 @@ TEST_CASE("New Game should reset the game") {
 
     g.tryMove(55, 39);
     g.tryMove(6, 21);
+    REQUIRE(g.getMoveHistory().size() == 2);
+    REQUIRE(g.getMoveHistory()[1] == Move(6, 21, MOVE));
     g.newGame();
 
-    REQUIRE(g.getMoves().empty());
+    REQUIRE(g.getMoves().size() == 20);
+    REQUIRE(g.getMoveHistory().empty());
     REQUIRE(g.getBoard() == startingBoard);
 }
 
+TEST_CASE("The engine can move first after a new game") {
+    Game g{};
+    g.tryMove(52, 36);
+    g.newGame();
+
+    // As when the player chooses black: the engine's move is checked against the position, then made
+    SearchLimits limits;
+    limits.depth = 3;
+    Move m = g.bestMove(limits);
+    REQUIRE(g.isLegal(m));
+    REQUIRE(g.makeMove(m) == GAME_CONTINUES);
+    REQUIRE(g.getActivePlayer() == BLACK);
+    REQUIRE(g.getMoveHistory().size() == 1);
+
+    REQUIRE(!g.isLegal(Move{52, 36, FORCED_MARCH})); // e4 again, for black
+}
+
 TEST_CASE("Board set and get functions", "") {
     Game g{};
 
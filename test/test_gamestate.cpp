@@ -1,9 +1,13 @@
+#include <algorithm>
+#include <iterator>
 #include <iostream>
 #include "catch.hpp"
 
 #include "../src/Move.h"
 #include "../src/Game.h"
 #include "../src/GameState.h"
+#include "../src/Perft.h"
+#include "treewalk.h"
 
 using namespace CA3;
 
@@ -251,6 +255,40 @@ TEST_CASE("Test isThreatenedBy", "") {
     }
 }
 
+// Checks the cached attack maps against attackersTo
+void requireAttackMapsMatch(GameState& gs) {
+    for (Color c : {BLACK, WHITE}) {
+        Bitboard expected = EMPTY_BOARD;
+        for (Square s = 0; s < 64; s++) {
+            if (gs.attackersTo(s, gs.occupied()) & gs.colorBoard(c)) {
+                expected |= squareBit(s);
+            }
+        }
+        REQUIRE(gs.attackedBy(c) == expected);
+    }
+}
+
+TEST_CASE("Test attackedBy", "") {
+    SECTION("The attack maps follow every move") {
+        GameState gs = parseFen(promotionFen);
+        forEachNode(gs, 2, requireAttackMapsMatch);
+
+        gs = parseFen(kiwipeteFen);
+        forEachNode(gs, 2, requireAttackMapsMatch);
+    }
+
+    SECTION("Setting pieces directly updates the attack maps") {
+        GameState gs = parseFen("4k3/8/8/8/8/8/8/4K3 w - - 0 1");
+        REQUIRE(!contains(gs.attackedBy(WHITE), 12)); // e7
+        gs[52] = WHITE_ROOK; // e2
+        REQUIRE(contains(gs.attackedBy(WHITE), 12));
+        REQUIRE(gs.isThreatenedBy(4, WHITE));
+        gs[28] = BLACK_PAWN; // e4
+        REQUIRE(!contains(gs.attackedBy(WHITE), 12));
+        REQUIRE(!gs.isThreatenedBy(4, WHITE));
+    }
+}
+
 TEST_CASE("Test generateMoves", "") {
     GameState gs;
     gs.makeEmpty();
@@ -467,11 +505,377 @@ TEST_CASE("Test generateMoves", "") {
         gs[56] = WHITE_KNIGHT;
         gs[57] = WHITE_KING;
 
-        // 4 promo moves (Q, N), 2 knight moves, 2 king moves = 8
-        REQUIRE(gs.generateMoves().size() == 8);
+        // 8 promo moves (Q, N, R, B), 2 knight moves, 2 king moves = 12
+        REQUIRE(gs.generateMoves().size() == 12);
 
         gs.setToAct(BLACK);
-        // 12 rook moves, 2 promo moves = 14
-        REQUIRE(gs.generateMoves().size() == 14);
+        // 12 rook moves, 4 promo moves = 16
+        REQUIRE(gs.generateMoves().size() == 16);
+    }
+
+    SECTION("Generating en passant moves") {
+        // . . . . k . . .
+        // . . . p . . . .
+        // . . . . . . . .
+        // . . . . P . . .
+        // . . . . . . . .
+        // . . . . . . . .
+        // . . . . . . . .
+        // . . . . K . . .
+        gs[4] = BLACK_KING;
+        gs[11] = BLACK_PAWN;
+        gs[28] = WHITE_PAWN;
+        gs[60] = WHITE_KING;
+        gs.setBlackKingLocation(4);
+        gs.setWhiteKingLocation(60);
+
+        gs.setToAct(BLACK);
+        gs.makeMove({11, 27, FORCED_MARCH});
+
+        // 5 king moves, 1 pawn move, 1 en passant = 7
+        std::vector<Move> moves = gs.generateMoves();
+        REQUIRE(moves.size() == 7);
+        REQUIRE(std::any_of(moves.begin(), moves.end(), [](Move m) {
+            return m.from == 28 && m.to == 19 && m.type == EN_PASSANT;
+        }));
+    }
+
+    SECTION("Sliders can't move past a piece they can't legally capture") {
+        // . . . . . . . .
+        // . . . . . . . .
+        // K . . . . . . r
+        // . . . p . . . .
+        // . . . R . . . k
+        // . . . . . . . .
+        // . . . . . . . .
+        // . . . . . . . .
+        gs[16] = WHITE_KING;
+        gs[23] = BLACK_ROOK;
+        gs[27] = BLACK_PAWN;
+        gs[35] = WHITE_ROOK;
+        gs[39] = BLACK_KING;
+        gs.setWhiteKingLocation(16);
+        gs.setBlackKingLocation(39);
+
+        // White is in check and the rook could only block on d6, which is behind the pawn
+        std::vector<Move> moves = gs.generateMoves();
+        REQUIRE(std::none_of(moves.begin(), moves.end(), [](Move m) { return m.from == 35; }));
+    }
+
+    SECTION("Pinned pieces only move along the pin") {
+        // k . . . r . . .
+        // . . . . . . . .
+        // . . . . . . . .
+        // b . . . . . . .
+        // . . . . . . . .
+        // . . . . R . . .
+        // . . . N . . . .
+        // . . . . K . . .
+        gs[0] = BLACK_KING;
+        gs[4] = BLACK_ROOK;
+        gs[24] = BLACK_BISHOP;
+        gs[44] = WHITE_ROOK;
+        gs[51] = WHITE_KNIGHT;
+        gs[60] = WHITE_KING;
+        gs.setBlackKingLocation(0);
+        gs.setWhiteKingLocation(60);
+
+        // 4 king moves and 6 rook moves on the e file. The knight can't move at all
+        std::vector<Move> moves = gs.generateMoves();
+        REQUIRE(moves.size() == 10);
+        REQUIRE(std::none_of(moves.begin(), moves.end(), [](Move m) { return m.from == 51; }));
+        REQUIRE(std::all_of(moves.begin(), moves.end(), [](Move m) { return m.from != 44 || m.to % 8 == 4; }));
+    }
+
+    SECTION("Only the king moves in double check") {
+        // . . . Q r . . k
+        // . . . . . . . .
+        // . . . . . . . .
+        // . . . . . . . .
+        // . . . . . . . .
+        // . . . n . . . .
+        // . . . . . . . .
+        // . . . . K . . .
+        gs[3] = WHITE_QUEEN;
+        gs[4] = BLACK_ROOK;
+        gs[7] = BLACK_KING;
+        gs[43] = BLACK_KNIGHT;
+        gs[60] = WHITE_KING;
+        gs.setBlackKingLocation(7);
+        gs.setWhiteKingLocation(60);
+
+        // The queen could capture either checker, but that still leaves the king in check: Kd1, Kd2 and Kf1
+        std::vector<Move> moves = gs.generateMoves();
+        REQUIRE(moves.size() == 3);
+        REQUIRE(std::all_of(moves.begin(), moves.end(), [](Move m) { return m.from == 60; }));
+    }
+}
+
+// Checks generateCaptures against the captures and promotions among all moves
+void requireCapturesMatch(GameState& gs) {
+    std::vector<Move> all = gs.generateMoves();
+    std::vector<Move> expected;
+    std::copy_if(all.begin(), all.end(), std::back_inserter(expected),
+                 [](Move m) { return m.isCapture() || m.isPromotion(); });
+    REQUIRE(gs.generateCaptures() == expected);
+}
+
+TEST_CASE("Test generateCaptures", "") {
+    GameState gs = parseFen(promotionFen);
+    forEachNode(gs, 2, requireCapturesMatch);
+
+    gs = parseFen(kiwipeteFen);
+    forEachNode(gs, 2, requireCapturesMatch);
+}
+
+// Checks captures plus quiet moves, and evasions in check, against all moves
+void requireGenerationTypesMatch(GameState& gs) {
+    MoveList all, split, evasions;
+    gs.generate<ALL>(all);
+    gs.generate<CAPTURES>(split);
+    gs.generate<QUIETS>(split);
+    REQUIRE(split.size() == all.size());
+    for (Move m : all) {
+        REQUIRE(split.contains(m));
+        REQUIRE(gs.isLegal(m));
+    }
+
+    if (gs.currentPlayerInCheck()) {
+        gs.generate<EVASIONS>(evasions);
+        REQUIRE(evasions.size() == all.size());
+        for (Move m : all) {
+            REQUIRE(evasions.contains(m));
+        }
+    }
+}
+
+TEST_CASE("Test generate", "") {
+    SECTION("Every generation type agrees with generating all moves") {
+        GameState gs = parseFen(promotionFen);
+        forEachNode(gs, 2, requireGenerationTypesMatch);
+
+        gs = parseFen(kiwipeteFen);
+        forEachNode(gs, 2, requireGenerationTypesMatch);
+    }
+
+    SECTION("Evasions") {
+        // Double check from the rook and knight: only the king moves, even though the a3 rook could take the knight
+        GameState gs = parseFen("4r2k/8/8/8/8/R2n4/8/4K3 w - - 0 1");
+        MoveList moves;
+        gs.generate<EVASIONS>(moves);
+        REQUIRE(moves.size() == 3);
+        REQUIRE(std::all_of(moves.begin(), moves.end(), [](Move m) { return m.from == 60; }));
+
+        // En passant takes the pawn that checked by marching
+        gs = parseFen("8/8/8/2k5/3Pp3/8/8/4K3 b - d3 0 1");
+        moves.clear();
+        gs.generate<EVASIONS>(moves);
+        REQUIRE(moves.contains(Move{36, 43, EN_PASSANT}));
+
+        // Promoting blocks the check, or takes the checker, and counts as a capture either way
+        gs = parseFen("1r2K3/2P5/8/8/8/8/8/k7 w - - 0 1");
+        moves.clear();
+        gs.generate<CAPTURES>(moves);
+        REQUIRE(moves.contains(Move{10, 2, PROMOTION_QUEEN}));
+        REQUIRE(moves.contains(Move{10, 1, PROMOTION_KNIGHT_CAPTURE}));
+        moves.clear();
+        gs.generate<QUIETS>(moves);
+        REQUIRE(std::all_of(moves.begin(), moves.end(), [](Move m) { return m.from == 4; }));
+    }
+
+    SECTION("Generating for some pieces only") {
+        GameState gs;
+        MoveList moves;
+        gs.generate<ALL>(moves, squareBit(62)); // The g1 knight
+        REQUIRE(moves.size() == 2);
+    }
+
+    SECTION("Moves from elsewhere are checked for legality") {
+        GameState gs = parseFen("4k3/8/8/8/8/8/3r4/4K2R w K - 0 1");
+        REQUIRE(!gs.isLegal(Move{60, 52, MOVE})); // Into check
+        REQUIRE(gs.isLegal(Move{60, 51, CAPTURE}));
+        REQUIRE(!gs.isLegal(Move{60, 51, MOVE})); // The right squares but the wrong type
+        REQUIRE(gs.isLegal(Move{63, 62, MOVE}));
+        REQUIRE(gs.isLegal(Move{60, 63, CASTLE_EAST}));
+        REQUIRE(!gs.isLegal(Move{28, 20, MOVE})); // Nothing there
+        REQUIRE(!gs.isLegal(Move{}));
+    }
+}
+
+// Checks hasLegalMove against generating every move
+void requireHasLegalMoveMatches(GameState& gs) {
+    REQUIRE(gs.hasLegalMove() == !gs.generateMoves().empty());
+}
+
+TEST_CASE("Test hasLegalMove", "") {
+    SECTION("Checkmate and stalemate have no legal moves") {
+        GameState gs = parseFen("7k/6Q1/6K1/8/8/8/8/8 b - - 0 1");
+        REQUIRE(!gs.hasLegalMove());
+
+        gs = parseFen("7k/5Q2/6K1/8/8/8/8/8 b - - 0 1");
+        REQUIRE(!gs.hasLegalMove());
+    }
+
+    SECTION("Agrees with generating every move") {
+        GameState gs = parseFen(promotionFen);
+        forEachNode(gs, 3, requireHasLegalMoveMatches);
+
+        gs = parseFen(endgameFen);
+        forEachNode(gs, 4, requireHasLegalMoveMatches);
+    }
+}
+
+// Finds the move written in coordinate notation among the legal moves
+Move findMove(GameState& gs, const std::string& notation) {
+    for (Move m : gs.generateMoves()) {
+        if (moveToString(m) == notation) {
+            return m;
+        }
+    }
+    FAIL("No legal move " << notation);
+    return Move{};
+}
+
+TEST_CASE("Test staticExchange", "") {
+    SECTION("Undefended pieces are won outright") {
+        GameState gs = parseFen("1k1r4/1pp4p/p7/4p3/8/P5P1/1PP4P/2K1R3 w - - 0 1");
+        REQUIRE(gs.staticExchange(findMove(gs, "e1e5")) == 100);
+    }
+
+    SECTION("Exchanges are played out least valuable attacker first, including x-rays") {
+        GameState gs = parseFen("1k1r3q/1ppn3p/p4b2/4p3/8/P2N2P1/1PP1R1BP/2K1Q3 w - - 0 1");
+        REQUIRE(gs.staticExchange(findMove(gs, "d3e5")) == -220);
+        REQUIRE(gs.staticExchange(findMove(gs, "e2e5")) == -400);
+        REQUIRE(gs.staticExchange(findMove(gs, "g2b7")) == -230); // The king can recapture
+    }
+
+    SECTION("Promotions and en passant") {
+        GameState gs = parseFen("4k3/1P6/8/3pP3/2n5/1P6/8/4K1Q1 w - d6 0 1");
+        REQUIRE(gs.staticExchange(findMove(gs, "b7b8q")) == 800);
+        REQUIRE(gs.staticExchange(findMove(gs, "b7b8n")) == 220);
+        REQUIRE(gs.staticExchange(findMove(gs, "e5d6")) == 0); // The knight takes back
+        REQUIRE(gs.staticExchange(findMove(gs, "b3c4")) == 220);
+        REQUIRE(gs.staticExchange(findMove(gs, "g1g2")) == 0);
+    }
+}
+
+// Checks givesCheck against making each move and looking
+void requireGivesCheckMatches(GameState& gs) {
+    for (Move m : gs.generateMoves()) {
+        bool predicted = gs.givesCheck(m);
+        gs.makeMove(m);
+        REQUIRE(predicted == gs.currentPlayerInCheck());
+        gs.unmakeMove();
+    }
+}
+
+TEST_CASE("Test givesCheck", "") {
+    SECTION("Direct and discovered checks") {
+        GameState gs = parseFen("4k3/8/8/8/4N3/8/8/4R1K1 w - - 0 1");
+        REQUIRE(gs.givesCheck(findMove(gs, "e4d6"))); // Both
+        REQUIRE(gs.givesCheck(findMove(gs, "e4c3"))); // Discovered
+        REQUIRE(!gs.givesCheck(findMove(gs, "g1h1")));
+        REQUIRE(!gs.givesCheck(findMove(gs, "e1e2")));
+    }
+
+    SECTION("En passant uncovers the rank of both pawns") {
+        GameState gs = parseFen("8/8/8/R1pP3k/8/8/8/K7 w - c6 0 1");
+        REQUIRE(gs.givesCheck(findMove(gs, "d5c6")));
+        REQUIRE(!gs.givesCheck(findMove(gs, "d5d6")));
+    }
+
+    SECTION("Promoted pieces check through the square the pawn left") {
+        GameState gs = parseFen("8/1P6/8/1k6/8/8/8/4K3 w - - 0 1");
+        REQUIRE(gs.givesCheck(findMove(gs, "b7b8q")));
+        REQUIRE(gs.givesCheck(findMove(gs, "b7b8r")));
+        REQUIRE(!gs.givesCheck(findMove(gs, "b7b8b")));
+        REQUIRE(!gs.givesCheck(findMove(gs, "b7b8n")));
+    }
+
+    SECTION("Castling checks with the rook") {
+        GameState gs = parseFen("5k2/8/8/8/8/8/8/4K2R w K - 0 1");
+        REQUIRE(gs.givesCheck(Move{60, 63, CASTLE_EAST}));
+
+        gs = parseFen("6k1/8/8/8/8/8/8/4K2R w K - 0 1");
+        REQUIRE(!gs.givesCheck(Move{60, 63, CASTLE_EAST}));
+    }
+
+    SECTION("Agrees with making the move") {
+        // Moves up to 3, 2 and 4 plies deep
+        GameState gs = parseFen(promotionFen);
+        forEachNode(gs, 2, requireGivesCheckMatches);
+
+        gs = parseFen(kiwipeteFen);
+        forEachNode(gs, 1, requireGivesCheckMatches);
+
+        gs = parseFen(endgameFen);
+        forEachNode(gs, 3, requireGivesCheckMatches);
+    }
+}
+
+// Checks that unmaking each move restores the position exactly
+void requireUnmakeRestores(GameState& gs) {
+    uint64_t key = gs.getKey();
+    Square kings[2] = {gs.getKingLocation(WHITE), gs.getKingLocation(BLACK)};
+    for (Move m : gs.generateMoves()) {
+        gs.makeMove(m);
+        gs.unmakeMove();
+        REQUIRE(gs.getKey() == key);
+        REQUIRE(gs.computeKey() == key);
+        REQUIRE(gs.getKingLocation(WHITE) == kings[0]);
+        REQUIRE(gs.getKingLocation(BLACK) == kings[1]);
+    }
+}
+
+TEST_CASE("Test unmakeMove", "") {
+    SECTION("Unmaking restores every position in the tree") {
+        GameState gs = parseFen(promotionFen);
+        forEachNode(gs, 2, requireUnmakeRestores);
+
+        gs = parseFen(kiwipeteFen);
+        forEachNode(gs, 1, requireUnmakeRestores);
+    }
+
+    SECTION("Moves can be unmade in sequence") {
+        GameState gs;
+        uint64_t start = gs.getKey();
+
+        gs.makeMove({52, 36, FORCED_MARCH}); // e4
+        gs.makeMove({11, 27, FORCED_MARCH}); // d5
+        gs.makeMove({36, 27, CAPTURE}); // exd5
+        gs.makeMove({12, 28, FORCED_MARCH}); // e5
+        gs.makeMove({27, 20, EN_PASSANT}); // dxe6
+        REQUIRE(gs[28] == NO_PIECE);
+
+        gs.unmakeMove();
+        REQUIRE(gs[27] == WHITE_PAWN);
+        REQUIRE(gs[28] == BLACK_PAWN);
+        REQUIRE(gs[20] == NO_PIECE);
+        REQUIRE(gs.getEnPassantSquare() == 20);
+
+        for (int i = 0; i < 4; i++) {
+            gs.unmakeMove();
+        }
+        REQUIRE(gs.getKey() == start);
+        REQUIRE(gs.getToAct() == WHITE);
+    }
+
+    SECTION("Null moves only pass the turn") {
+        GameState gs;
+        gs.makeMove({52, 36, FORCED_MARCH}); // e4
+        uint64_t key = gs.getKey();
+
+        gs.makeNullMove();
+        REQUIRE(gs.getToAct() == WHITE);
+        REQUIRE(gs.getEnPassantSquare() == INVALID_SQUARE);
+        REQUIRE(gs.getKey() == gs.computeKey());
+        REQUIRE(gs[36] == WHITE_PAWN);
+
+        gs.makeMove({51, 35, FORCED_MARCH}); // d4
+        gs.unmakeMove();
+        gs.unmakeNullMove();
+        REQUIRE(gs.getToAct() == BLACK);
+        REQUIRE(gs.getEnPassantSquare() == 44);
+        REQUIRE(gs.getKey() == key);
     }
 }
@@ -20,3 +20,16 @@ TEST_CASE("Test isCapture") {
     }
 }
 
+
+TEST_CASE("Test pack and unpack") {
+    REQUIRE(Move{}.pack() == 0);
+
+    for(int t = MOVE; t <= PROMOTION_KNIGHT_CAPTURE; t++) {
+        for(CA3::Square from = 0; from < 64; from += 7) {
+            for(CA3::Square to = 0; to < 64; to += 5) {
+                Move m = {from, to, static_cast<MoveType>(t)};
+                REQUIRE(Move::unpack(m.pack()) == m);
+            }
+        }
+    }
+}
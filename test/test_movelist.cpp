@@ -0,0 +1,62 @@
+#include <algorithm>
+#include "catch.hpp"
+
+#include "../src/Game.h"
+#include "../src/GameState.h"
+#include "../src/MoveList.h"
+#include "../src/Perft.h"
+#include "treewalk.h"
+
+using namespace CA3;
+
+TEST_CASE("Test MoveList") {
+    SECTION("Lists hold moves in the order they're added") {
+        MoveList list;
+        REQUIRE(list.empty());
+
+        list.push_back({52, 36, FORCED_MARCH});
+        list.emplace_back(62, 45, MOVE);
+        REQUIRE(list.size() == 2);
+        REQUIRE(list[0] == Move(52, 36, FORCED_MARCH));
+        REQUIRE(list[1] == Move(62, 45, MOVE));
+        REQUIRE(list.contains({62, 45, MOVE}));
+        REQUIRE(!list.contains({62, 46, MOVE}));
+
+        list.clear();
+        REQUIRE(list.empty());
+        REQUIRE(list.begin() == list.end());
+    }
+
+    SECTION("Generating into a list matches generating into a vector") {
+        GameState gs = parseFen(promotionFen);
+        MoveList list;
+        list.push_back(Move{}); // Replaced, not appended to
+        gs.generateMoves(list);
+        std::vector<Move> vector = gs.generateMoves();
+        REQUIRE(std::equal(list.begin(), list.end(), vector.begin(), vector.end()));
+
+        gs.generateCaptures(list);
+        vector = gs.generateCaptures();
+        REQUIRE(std::equal(list.begin(), list.end(), vector.begin(), vector.end()));
+    }
+
+    SECTION("The position with the most known legal moves fits") {
+        GameState gs = parseFen("R6R/3Q4/1Q4Q1/4Q3/2Q4Q/Q4Q2/pp1Q4/kBNN1KB1 w - - 0 1");
+        MoveList list;
+        gs.generateMoves(list);
+        REQUIRE(list.size() == 218);
+    }
+
+    SECTION("Views see a list in place") {
+        MoveList list;
+        list.emplace_back(12, 28, FORCED_MARCH);
+        MoveView view{list};
+        REQUIRE(view.size() == 1);
+        REQUIRE(view.begin() == list.begin());
+
+        Game g;
+        MoveView moves = g.getMoves();
+        REQUIRE(moves.size() == 20);
+        REQUIRE(std::find(moves.begin(), moves.end(), Move(52, 36, FORCED_MARCH)) != moves.end());
+    }
+}
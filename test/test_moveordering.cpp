@@ -0,0 +1,224 @@
+#include <algorithm>
+#include "catch.hpp"
+
+#include "../src/MoveOrdering.h"
+#include "../src/Perft.h"
+#include "../src/Search.h"
+#include "treewalk.h"
+
+using namespace CA3;
+
+namespace {
+    Move findMove(const MoveList& moves, const std::string& str) {
+        for (Move m : moves) {
+            if (moveToString(m) == str) {
+                return m;
+            }
+        }
+        FAIL("Move not found: " << str);
+        return Move{};
+    }
+
+    int scoreOf(const MoveList& moves, const int* scores, Move m) {
+        return scores[std::find(moves.begin(), moves.end(), m) - moves.begin()];
+    }
+
+    // The moves in the order a StagedMovePicker hands them out
+    std::vector<Move> staged(GameState& gs, const MoveOrdering* ordering, Move hashMove, int ply, Move previous) {
+        MoveList moves;
+        int scores[MoveList::CAPACITY];
+        std::vector<Move> order;
+        StagedMovePicker picker{gs, ordering, moves, scores, hashMove, ply, previous, gs.currentPlayerInCheck()};
+        Move m;
+        int score;
+        while (picker.next(m, score)) {
+            order.push_back(m);
+        }
+        return order;
+    }
+}
+
+TEST_CASE("Test MoveOrdering") {
+    MoveOrdering ordering;
+    int scores[MoveList::CAPACITY];
+
+    // The pawn can take the queen or the knight
+    GameState gs = parseFen("4k3/8/2n1q3/3P4/8/8/3Q4/7K w - - 0 1");
+    MoveList moves;
+    gs.generateMoves(moves);
+    Move pawnTakesQueen = findMove(moves, "d5e6");
+    Move pawnTakesKnight = findMove(moves, "d5c6");
+    Move quiet = findMove(moves, "h1g1");
+    Move otherQuiet = findMove(moves, "d2a5");
+
+    SECTION("Captures come first, most valuable victim then least valuable attacker") {
+        ordering.score(gs, moves, Move{}, 0, Move{}, scores);
+        std::vector<Move> order = staged(gs, &ordering, Move{}, 0, Move{});
+        REQUIRE(order[0] == pawnTakesQueen);
+        REQUIRE(order[1] == pawnTakesKnight);
+        REQUIRE(!order[2].isCapture());
+        REQUIRE(MoveOrdering::stageOf(scoreOf(moves, scores, pawnTakesKnight)) == MoveOrdering::CAPTURE);
+    }
+
+    SECTION("The hash move comes before everything") {
+        std::vector<Move> order = staged(gs, &ordering, quiet, 0, Move{});
+        REQUIRE(order[0] == quiet);
+        REQUIRE(order[1] == pawnTakesQueen);
+    }
+
+    SECTION("Killers follow captures, at their own ply") {
+        ordering.recordCutoff(gs, quiet, 0, 3, 2, 4, Move{}, {});
+        std::vector<Move> order = staged(gs, &ordering, Move{}, 2, Move{});
+        REQUIRE(order[2] == quiet);
+
+        ordering.recordCutoff(gs, otherQuiet, 0, 3, 2, 4, Move{}, {});
+        order = staged(gs, &ordering, Move{}, 2, Move{});
+        REQUIRE(order[2] == otherQuiet);
+        REQUIRE(order[3] == quiet);
+
+        // newSearch forgets killers, but history still ranks them above untried quiet moves
+        ordering.newSearch();
+        ordering.score(gs, moves, Move{}, 2, Move{}, scores);
+        order = staged(gs, &ordering, Move{}, 2, Move{});
+        REQUIRE(MoveOrdering::stageOf(scoreOf(moves, scores, quiet)) == MoveOrdering::QUIET);
+        REQUIRE((order[2] == quiet || order[2] == otherQuiet));
+    }
+
+    SECTION("Countermoves answer the previous move anywhere in the tree") {
+        Move previous{12, 20, MOVE};
+        ordering.recordCutoff(gs, quiet, 0, 3, 5, 4, previous, {});
+        ordering.score(gs, moves, Move{}, 9, previous, scores);
+        std::vector<Move> order = staged(gs, &ordering, Move{}, 9, previous);
+        REQUIRE(order[2] == quiet);
+        REQUIRE(MoveOrdering::stageOf(scoreOf(moves, scores, quiet)) == MoveOrdering::COUNTERMOVE);
+
+        ordering.score(gs, moves, Move{}, 9, Move{13, 21, MOVE}, scores);
+        REQUIRE(MoveOrdering::stageOf(scoreOf(moves, scores, quiet)) == MoveOrdering::QUIET);
+    }
+
+    SECTION("History rewards cutoffs and marks down the quiet moves tried before them") {
+        MoveList quietsTried;
+        quietsTried.push_back(otherQuiet);
+        ordering.recordCutoff(gs, quiet, 0, 1, 3, 6, Move{}, quietsTried);
+        ordering.newSearch(); // Drop the killer
+        ordering.score(gs, moves, Move{}, 3, Move{}, scores);
+        REQUIRE(scoreOf(moves, scores, quiet) > 0);
+        REQUIRE(scoreOf(moves, scores, otherQuiet) < 0);
+    }
+
+    SECTION("Statistics count cutoffs") {
+        ordering.recordCutoff(gs, pawnTakesQueen, (1 << 28) + 1, 0, 0, 1, Move{}, {});
+        ordering.recordCutoff(gs, quiet, 0, 3, 0, 1, Move{}, {});
+        const MoveOrdering::Stats& stats = ordering.stats();
+        REQUIRE(stats.cutNodes == 2);
+        REQUIRE(stats.firstMoveCutoffs == 1);
+        REQUIRE(stats.firstMoveCutoffRate() == Approx(0.5));
+        REQUIRE(stats.averageMovesBeforeCutoff() == Approx(2.5));
+        REQUIRE(stats.cutoffsByStage[MoveOrdering::CAPTURE] == 1);
+        REQUIRE(stats.cutoffsByStage[MoveOrdering::QUIET] == 1);
+    }
+}
+
+TEST_CASE("Test StagedMovePicker") {
+    MoveOrdering ordering;
+    int scores[MoveList::CAPACITY];
+
+    SECTION("Staged picking hands out the same moves in the same order as scoring them all") {
+        GameState gs = parseFen(kiwipeteFen);
+        MoveList moves;
+        gs.generateMoves(moves);
+        Move hashMove = findMove(moves, "e2a6");
+        Move killer = findMove(moves, "a2a3");
+        Move counter = findMove(moves, "g2g3");
+        Move previous{12, 20, MOVE};
+        ordering.recordCutoff(gs, killer, 0, 3, 1, 4, previous, {});
+        ordering.recordCutoff(gs, counter, 0, 3, 5, 4, previous, {});
+
+        std::vector<Move> order = staged(gs, &ordering, hashMove, 1, previous);
+        REQUIRE(order.size() == moves.size());
+        REQUIRE(order[0] == hashMove);
+
+        // Moves are generated in a different order, so equal scores may come out in a different order. Quiet
+        // moves are history ordered either way, so stop at the first
+        ordering.score(gs, moves, hashMove, 1, previous, scores);
+        std::vector<Move> expected{moves.begin(), moves.end()};
+        std::stable_sort(expected.begin(), expected.end(), [&](Move a, Move b) {
+            return scoreOf(moves, scores, a) > scoreOf(moves, scores, b);
+        });
+        for (size_t i = 0; MoveOrdering::stageOf(scoreOf(moves, scores, expected[i])) != MoveOrdering::QUIET; i++) {
+            REQUIRE(scoreOf(moves, scores, order[i]) == scoreOf(moves, scores, expected[i]));
+        }
+
+        std::sort(order.begin(), order.end(), [](Move a, Move b) { return a.pack() < b.pack(); });
+        std::sort(expected.begin(), expected.end(), [](Move a, Move b) { return a.pack() < b.pack(); });
+        REQUIRE(order == expected);
+    }
+
+    SECTION("Hash moves and killers that aren't legal here are skipped") {
+        GameState gs = parseFen("4k3/2n1q3/3P4/8/8/8/3Q4/7K w - - 0 1");
+        MoveList moves;
+        gs.generateMoves(moves);
+        Move notACapture{51, 35, CAPTURE}; // Qd4 takes nothing
+        Move legalKiller = findMove(moves, "h1h2");
+        ordering.recordCutoff(gs, legalKiller, 0, 3, 0, 4, Move{}, {});
+        ordering.recordCutoff(gs, Move{0, 8, MOVE}, 0, 3, 0, 4, Move{}, {}); // Nothing on a8
+
+        std::vector<Move> order = staged(gs, &ordering, notACapture, 0, Move{});
+        REQUIRE(order.size() == moves.size());
+        REQUIRE(std::find(order.begin(), order.end(), notACapture) == order.end());
+        REQUIRE(order[0].isCapture());
+        REQUIRE(order[2] == legalKiller);
+    }
+
+    SECTION("In check only evasions are handed out") {
+        GameState gs = parseFen("4k3/8/8/8/8/8/4r3/4K2R w K - 0 1");
+        REQUIRE(gs.currentPlayerInCheck());
+        MoveList moves;
+        gs.generateMoves(moves);
+        std::vector<Move> order = staged(gs, &ordering, Move{}, 0, Move{});
+        REQUIRE(order.size() == moves.size());
+        REQUIRE(order[0] == findMove(moves, "e1e2"));
+    }
+
+    SECTION("Without ordering, everything follows the hash move in generation order") {
+        GameState gs;
+        MoveList moves;
+        gs.generateMoves(moves);
+        Move hashMove = findMove(moves, "e2e4");
+        std::vector<Move> order = staged(gs, nullptr, hashMove, 0, Move{});
+        REQUIRE(order.size() == moves.size());
+        REQUIRE(order[0] == hashMove);
+        REQUIRE(order[1] == moves[0]);
+    }
+
+    SECTION("Positions without moves hand out nothing") {
+        GameState gs = parseFen("7k/5Q2/6K1/8/8/8/8/8 b - - 0 1");
+        REQUIRE(staged(gs, &ordering, Move{}, 0, Move{}).empty());
+    }
+}
+
+TEST_CASE("Test move ordering in search") {
+    TranspositionTable tt{1};
+    Search search{tt};
+    SearchLimits limits;
+    limits.depth = 6;
+
+    // Pruning changes which nodes are searched, so leave it out to compare like with like
+    search.options.nullMove = false;
+    search.options.lateMoveReductions = false;
+    search.options.reverseFutility = false;
+    search.options.futility = false;
+    GameState gs = parseFen(middlegameFen);
+
+    SearchResult ordered = search.think(gs, limits);
+    MoveOrdering::Stats orderedStats = search.orderingStats();
+
+    tt.clear();
+    search.options.moveOrdering = false;
+    SearchResult unordered = search.think(gs, limits);
+
+    REQUIRE(orderedStats.cutNodes > 0);
+    REQUIRE(orderedStats.firstMoveCutoffRate() > 0.8);
+    REQUIRE(orderedStats.firstMoveCutoffRate() > search.orderingStats().firstMoveCutoffRate());
+    REQUIRE(ordered.nodes < unordered.nodes);
+}
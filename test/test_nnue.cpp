@@ -0,0 +1,120 @@
+#include <cstring>
+#include <sstream>
+#include "catch.hpp"
+
+#include "../src/Error.h"
+#include "../src/GameState.h"
+#include "../src/Nnue.h"
+#include "../src/Perft.h"
+#include "../src/Search.h"
+#include "treewalk.h"
+
+using namespace CA3;
+
+bool operator == (const Nnue::Accumulator& a, const Nnue::Accumulator& b) {
+    return memcmp(&a, &b, sizeof(a)) == 0;
+}
+
+// Checks the accumulator after each move, updated from gs's, against one built from scratch
+void requireAccumulatorsMatch(const Nnue& network, GameState& gs) {
+    Nnue::Accumulator acc;
+    network.refresh(gs, acc);
+    for (Move m : gs.generateMoves()) {
+        gs.makeMove(m);
+        Nnue::Accumulator child, fresh;
+        network.update(acc, gs.getLastChanges(), child);
+        network.refresh(gs, fresh);
+        REQUIRE(child == fresh);
+        REQUIRE(network.evaluate(child, gs.getToAct()) == network.evaluate(gs));
+        gs.unmakeMove();
+    }
+}
+
+TEST_CASE("Test Nnue") {
+    Nnue network;
+    network.randomize(1);
+
+    SECTION("Updating from a move's changes matches refreshing") {
+        auto requireMatch = [&network](GameState& gs) { requireAccumulatorsMatch(network, gs); };
+        GameState gs = parseFen(promotionFen);
+        forEachNode(gs, 1, requireMatch);
+
+        gs = parseFen(kiwipeteFen);
+        forEachNode(gs, 1, requireMatch);
+    }
+
+    SECTION("A null move changes nothing but the side to act") {
+        GameState gs = parseFen(kiwipeteFen);
+        Nnue::Accumulator acc, child;
+        network.refresh(gs, acc);
+        gs.makeNullMove();
+        network.update(acc, gs.getLastChanges(), child);
+        REQUIRE(child == acc);
+        REQUIRE(network.evaluate(child, gs.getToAct()) == network.evaluate(gs));
+    }
+
+    SECTION("Placing pieces directly records no more changes than a move can make") {
+        GameState gs;
+        for (Square s = 16; s < 40; s++) {
+            gs[s] = WHITE_KNIGHT;
+        }
+        REQUIRE(gs.getLastChanges().count == 4);
+    }
+
+    SECTION("An untrained network scores everything 0") {
+        GameState gs = parseFen(kiwipeteFen);
+        REQUIRE(Nnue{}.evaluate(gs) == 0);
+    }
+
+    SECTION("Saved networks load with the same weights") {
+        std::stringstream file;
+        network.save(file);
+        Nnue loaded;
+        loaded.load(file);
+
+        for (const char* fen : {"rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1",
+                                "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 b - - 0 1"}) {
+            GameState gs = parseFen(fen);
+            REQUIRE(loaded.evaluate(gs) == network.evaluate(gs));
+        }
+    }
+
+    SECTION("Files that don't hold a network are rejected") {
+        REQUIRE_THROWS_AS(Nnue{"no-such-network.bin"}, Error);
+
+        std::stringstream notANetwork{"Just some text, long enough to read a header from"};
+        REQUIRE_THROWS_AS(network.load(notANetwork), Error);
+
+        std::stringstream file;
+        network.save(file);
+        std::stringstream truncated{file.str().substr(0, 1000)};
+        REQUIRE_THROWS_AS(network.load(truncated), Error);
+    }
+
+    SECTION("Searches evaluate with the network") {
+        TranspositionTable tt{4};
+        Search search{tt};
+        SearchLimits limits;
+        limits.depth = 5;
+        GameState gs = parseFen(middlegameFen);
+        SearchResult tables = search.think(gs, limits);
+
+        tt.clear();
+        search.clear();
+        search.setNetwork(&network);
+        SearchResult neural = search.think(gs, limits);
+        REQUIRE(neural.nodes != tables.nodes);
+        for (Move m : neural.pv) {
+            std::vector<Move> legal = gs.generateMoves();
+            REQUIRE(std::find(legal.begin(), legal.end(), m) != legal.end());
+            gs.makeMove(m);
+        }
+
+        // The same again with the tables
+        tt.clear();
+        search.clear();
+        search.setNetwork(nullptr);
+        gs = parseFen(middlegameFen);
+        REQUIRE(search.think(gs, limits).nodes == tables.nodes);
+    }
+}
@@ -0,0 +1,108 @@
+#include "catch.hpp"
+
+#include "../src/Perft.h"
+#include "treewalk.h"
+
+using namespace CA3;
+
+// Reference counts are from the same page as the positions
+
+TEST_CASE("Test parseFen") {
+    SECTION("Start position matches the default GameState") {
+        GameState gs = parseFen(startFen);
+        GameState defaultGs;
+
+        for (Square s = 0; s < 64; s++) {
+            REQUIRE(gs[s] == defaultGs[s]);
+        }
+        REQUIRE(gs.getKey() == defaultGs.getKey());
+    }
+
+    SECTION("Side to move and en passant are read") {
+        GameState gs = parseFen("rnbqkbnr/ppp1pppp/8/8/3pP3/8/PPPP1PPP/RNBQKBNR b KQkq e3 0 3");
+        REQUIRE(gs.getToAct() == BLACK);
+        REQUIRE(gs.getEnPassantSquare() == 44);
+    }
+
+    SECTION("Bad FENs throw") {
+        REQUIRE_THROWS(parseFen(""));
+        REQUIRE_THROWS(parseFen("rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP w KQkq - 0 1"));
+        REQUIRE_THROWS(parseFen("rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNX w KQkq - 0 1"));
+        REQUIRE_THROWS(parseFen("rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR x KQkq - 0 1"));
+    }
+}
+
+TEST_CASE("Test perft counts") {
+    SECTION("Start position") {
+        GameState gs = parseFen(startFen);
+        REQUIRE(perft(gs, 1) == 20);
+        REQUIRE(perft(gs, 2) == 400);
+        REQUIRE(perft(gs, 3) == 8902);
+    }
+
+    SECTION("Kiwipete: castling, en passant and pins") {
+        GameState gs = parseFen(kiwipeteFen);
+        REQUIRE(perft(gs, 1) == 48);
+        REQUIRE(perft(gs, 2) == 2039);
+    }
+
+    SECTION("Rook and pawn endgame: discovered checks and en passant pins") {
+        GameState gs = parseFen(endgameFen);
+        REQUIRE(perft(gs, 1) == 14);
+        REQUIRE(perft(gs, 2) == 191);
+        REQUIRE(perft(gs, 3) == 2812);
+        REQUIRE(perft(gs, 4) == 43238);
+    }
+
+    SECTION("Promotions and castling rights lost to captures") {
+        GameState gs = parseFen(promotionFen);
+        REQUIRE(perft(gs, 1) == 6);
+        REQUIRE(perft(gs, 2) == 264);
+        REQUIRE(perft(gs, 3) == 9467);
+    }
+
+    SECTION("Capture-promotions") {
+        GameState gs = parseFen(buggyFen);
+        REQUIRE(perft(gs, 1) == 44);
+        REQUIRE(perft(gs, 2) == 1486);
+    }
+
+    SECTION("Symmetrical middlegame") {
+        GameState gs = parseFen(middlegameFen);
+        REQUIRE(perft(gs, 1) == 46);
+        REQUIRE(perft(gs, 2) == 2079);
+    }
+}
+
+TEST_CASE("Test perftDivide") {
+    GameState gs = parseFen(kiwipeteFen);
+
+    SECTION("Divisions add up to the perft count") {
+        std::vector<PerftDivision> divisions = perftDivide(gs, 2);
+        REQUIRE(divisions.size() == 48);
+
+        uint64_t total = 0;
+        for (auto& d : divisions) {
+            total += d.nodes;
+        }
+        REQUIRE(total == 2039);
+    }
+
+    SECTION("Threads and the cache don't change the counts") {
+        PerftCache cache{1};
+        std::vector<PerftDivision> single = perftDivide(gs, 3);
+        std::vector<PerftDivision> threaded = perftDivide(gs, 3, 4, &cache);
+
+        REQUIRE(single.size() == threaded.size());
+        for (size_t i = 0; i < single.size(); i++) {
+            REQUIRE(single[i].nodes == threaded[i].nodes);
+        }
+    }
+}
+
+TEST_CASE("Test moveToString") {
+    REQUIRE(moveToString({52, 36, FORCED_MARCH}) == "e2e4");
+    REQUIRE(moveToString({60, 63, CASTLE_EAST}) == "e1g1");
+    REQUIRE(moveToString({4, 0, CASTLE_WEST}) == "e8c8");
+    REQUIRE(moveToString({8, 1, PROMOTION_KNIGHT_CAPTURE}) == "a7b8n");
+}
@@ -0,0 +1,64 @@
+#include "catch.hpp"
+
+#include "../src/Game.h"
+#include "../src/GameState.h"
+#include "../src/Perft.h"
+#include "../src/Search.h"
+#include "treewalk.h"
+
+using namespace CA3;
+
+// Checks the incrementally updated score and phase against ones built from scratch
+void requireScoresMatch(GameState& gs) {
+    REQUIRE(gs.getPieceSquareScore() == gs.computePieceSquareScore());
+    REQUIRE(gs.getPhase() == gs.computePhase());
+}
+
+TEST_CASE("Test piece-square evaluation") {
+    SECTION("makeMove and unmakeMove keep the score and phase up to date") {
+        GameState gs = parseFen(promotionFen);
+        TaperedScore before = gs.getPieceSquareScore();
+        forEachNode(gs, 3, requireScoresMatch);
+        REQUIRE(gs.getPieceSquareScore() == before);
+
+        gs = parseFen(kiwipeteFen);
+        forEachNode(gs, 2, requireScoresMatch);
+    }
+
+    SECTION("The starting position is balanced and in the middlegame") {
+        GameState gs;
+        REQUIRE(gs.getPieceSquareScore() == TaperedScore{0, 0});
+        REQUIRE(gs.getPhase() == MAX_PHASE);
+        REQUIRE(Search::evaluate(gs) == 0);
+    }
+
+    SECTION("Mirrored positions score the same for the side to act") {
+        GameState white = parseFen("r1bqkb1r/pppp1ppp/2n2n2/4p3/2B1P3/5N2/PPPP1PPP/RNBQK2R w KQkq - 4 4");
+        GameState black = parseFen("rnbqk2r/pppp1ppp/5n2/2b1p3/4P3/2N2N2/PPPP1PPP/R1BQKB1R b KQkq - 4 4");
+        REQUIRE(Search::evaluate(white) == Search::evaluate(black));
+        REQUIRE(Search::evaluate(white) != 0);
+    }
+
+    SECTION("The phase blends the middlegame and endgame scores") {
+        TaperedScore score{100, 300};
+        REQUIRE(taper(score, MAX_PHASE) == 100);
+        REQUIRE(taper(score, 0) == 300);
+        REQUIRE(taper(score, MAX_PHASE / 2) == 200);
+        REQUIRE(taper(score, MAX_PHASE + 4) == 100);
+
+        // Kings and pawns only
+        GameState gs = parseFen("8/4k3/4p3/8/8/3P4/4K3/8 w - - 0 1");
+        REQUIRE(gs.getPhase() == 0);
+    }
+
+    SECTION("Kings prefer shelter in the middlegame and the centre in the endgame") {
+        Square g1 = 62, e4 = 36;
+        TaperedScore sheltered = pieceSquareScore(WHITE_KING, g1);
+        TaperedScore central = pieceSquareScore(WHITE_KING, e4);
+        REQUIRE(sheltered.mg > central.mg);
+        REQUIRE(sheltered.eg < central.eg);
+
+        // Black's tables mirror white's
+        REQUIRE(pieceSquareScore(BLACK_KING, g1 ^ 56u) == TaperedScore{-sheltered.mg, -sheltered.eg});
+    }
+}
@@ -0,0 +1,257 @@
+#include <chrono>
+#include "catch.hpp"
+
+#include "../src/Game.h"
+#include "../src/Perft.h"
+#include "../src/Search.h"
+#include "treewalk.h"
+
+using namespace CA3;
+
+TEST_CASE("Test Search") {
+    TranspositionTable tt{1};
+    Search search{tt};
+    SearchLimits limits;
+
+    SECTION("Finds mate in one") {
+        // Back rank mate: Ra1-a8
+        GameState gs = parseFen("6k1/5ppp/8/8/8/8/8/R5K1 w - - 0 1");
+        limits.depth = 3;
+        SearchResult result = search.think(gs, limits);
+        REQUIRE(moveToString(result.bestMove) == "a1a8");
+        REQUIRE(result.score == Search::MATE_SCORE - 1);
+    }
+
+    SECTION("Finds mate in two") {
+        // Nf6+ gxf6 Bxf7#
+        GameState gs = parseFen("r2qkb1r/pp2nppp/3p4/2pNN1B1/2BnP3/3P4/PPP2PPP/R2bK2R w KQkq - 1 1");
+        limits.depth = 4;
+        SearchResult result = search.think(gs, limits);
+        REQUIRE(result.score == Search::MATE_SCORE - 3);
+        REQUIRE(result.pv.size() == 3);
+        REQUIRE(moveToString(result.pv[0]) == "d5f6");
+    }
+
+    SECTION("Wins hanging material") {
+        GameState gs = parseFen("4k3/8/8/3q4/8/8/3R4/4K3 w - - 0 1");
+        limits.depth = 2;
+        SearchResult result = search.think(gs, limits);
+        REQUIRE(moveToString(result.bestMove) == "d2d5");
+    }
+
+    SECTION("Resolves exchanges before scoring") {
+        // Qxd5 looks like it wins a pawn one ply deep, but exd5 wins the queen
+        GameState gs = parseFen("4k3/8/4p3/3p4/8/8/8/3QK3 w - - 0 1");
+        limits.depth = 1;
+        SearchResult result = search.think(gs, limits);
+        REQUIRE(moveToString(result.bestMove) != "d1d5");
+        REQUIRE(result.score > 500);
+    }
+
+    SECTION("Reports mate and stalemate with no move") {
+        SearchResult result = search.think(parseFen("R5k1/5ppp/8/8/8/8/8/6K1 b - - 0 1"), limits);
+        REQUIRE(result.bestMove == Move{});
+        REQUIRE(result.score == -Search::MATE_SCORE);
+
+        result = search.think(parseFen("7k/5Q2/8/8/8/8/8/6K1 b - - 0 1"), limits);
+        REQUIRE(result.bestMove == Move{});
+        REQUIRE(result.score == 0);
+    }
+
+    SECTION("Respects limits") {
+        GameState gs;
+        limits.depth = 3;
+        SearchResult result = search.think(gs, limits);
+        REQUIRE(result.depth == 3);
+
+        limits.depth = SearchLimits::MAX_DEPTH;
+        limits.nodes = 5000;
+        result = search.think(gs, limits);
+        REQUIRE(result.nodes <= 5000);
+        REQUIRE(result.bestMove != Move{});
+
+        limits.nodes = 0;
+        limits.timeMs = 50;
+        result = search.think(gs, limits);
+        REQUIRE(result.timeMs < 500);
+    }
+
+    SECTION("Principal variations are legal") {
+        GameState gs = parseFen(kiwipeteFen);
+        limits.depth = 4;
+        SearchResult result = search.think(gs, limits);
+        REQUIRE(!result.pv.empty());
+        REQUIRE(result.pv[0] == result.bestMove);
+
+        for (Move m : result.pv) {
+            std::vector<Move> legal = gs.generateMoves();
+            REQUIRE(std::find(legal.begin(), legal.end(), m) != legal.end());
+            gs.makeMove(m);
+        }
+    }
+
+    SECTION("Repetitions are draws") {
+        // White is a rook down, but Kg1 would repeat the position from before the last move
+        GameState gs = parseFen("k7/8/8/8/8/r7/8/7K w - - 0 1");
+        GameState repeated = gs;
+        repeated.makeMove({63, 62, MOVE});
+
+        limits.depth = 4;
+        SearchResult result = search.think(gs, limits, {repeated.getKey()});
+        REQUIRE(result.score == 0);
+        REQUIRE(result.bestMove == Move(63, 62, MOVE));
+
+        result = search.think(gs, limits);
+        REQUIRE(result.score < -400);
+    }
+
+    SECTION("Pruning shrinks the tree without missing tactics") {
+        // Nf6+ gxf6 Bxf7# is still found with each technique on its own and all together
+        GameState gs = parseFen("r2qkb1r/pp2nppp/3p4/2pNN1B1/2BnP3/3P4/PPP2PPP/R2bK2R w KQkq - 1 1");
+        limits.depth = 5;
+        SearchOptions none{true, false, false, false, false};
+        bool SearchOptions::* techniques[] = {&SearchOptions::nullMove, &SearchOptions::lateMoveReductions,
+                                              &SearchOptions::reverseFutility, &SearchOptions::futility};
+
+        search.options = none;
+        SearchResult unpruned = search.think(gs, limits);
+        REQUIRE(moveToString(unpruned.bestMove) == "d5f6");
+
+        for (bool SearchOptions::* technique : techniques) {
+            search.options = none;
+            search.options.*technique = true;
+            tt.clear();
+            search.clear();
+            SearchResult result = search.think(gs, limits);
+            REQUIRE(result.score == Search::MATE_SCORE - 3);
+            REQUIRE(result.nodes <= unpruned.nodes);
+        }
+
+        search.options = SearchOptions{};
+        tt.clear();
+        search.clear();
+        SearchResult pruned = search.think(gs, limits);
+        REQUIRE(pruned.score == Search::MATE_SCORE - 3);
+        REQUIRE(pruned.nodes < unpruned.nodes);
+    }
+}
+
+TEST_CASE("Test Search in steps") {
+    TranspositionTable tt{4};
+    Search search{tt};
+    SearchLimits limits;
+    limits.depth = 6;
+    GameState gs = parseFen(middlegameFen);
+
+    SECTION("Searching in steps finds the same result as all at once") {
+        SearchResult whole = search.think(gs, limits);
+
+        tt.clear();
+        search.clear();
+        search.startSearch(gs, limits);
+        int steps = 1;
+        while (search.searchStep(0, 500)) {
+            steps++;
+        }
+        SearchResult stepped = search.currentResult();
+
+        REQUIRE(steps > 10);
+        REQUIRE(stepped.nodes == whole.nodes);
+        REQUIRE(stepped.score == whole.score);
+        REQUIRE(stepped.depth == whole.depth);
+        REQUIRE(stepped.pv == whole.pv);
+    }
+
+    SECTION("Steps keep to their time budget and report progress") {
+        limits.depth = SearchLimits::MAX_DEPTH;
+        limits.timeMs = 300;
+        search.startSearch(gs, limits);
+
+        int reportedDepth = 0;
+        bool searching = true;
+        while (searching) {
+            auto start = std::chrono::steady_clock::now();
+            searching = search.searchStep(2000);
+            REQUIRE(std::chrono::steady_clock::now() - start < std::chrono::milliseconds(100));
+
+            SearchResult progress = search.currentResult();
+            REQUIRE(progress.depth >= reportedDepth);
+            reportedDepth = progress.depth;
+        }
+        REQUIRE(reportedDepth > 1);
+    }
+
+    SECTION("Steps after the search is done do nothing") {
+        GameState mated = parseFen("R5k1/5ppp/8/8/8/8/8/6K1 b - - 0 1");
+        search.startSearch(mated, limits);
+        REQUIRE(!search.searchStep(1000));
+        REQUIRE(search.currentResult().bestMove == Move{});
+        REQUIRE(search.currentResult().score == -Search::MATE_SCORE);
+    }
+}
+
+TEST_CASE("Test multithreaded Search") {
+    TranspositionTable tt{4};
+    Search search{tt};
+    search.setThreads(4);
+    REQUIRE(search.getThreads() == 4);
+    SearchLimits limits;
+
+    SECTION("Finds the same mate") {
+        GameState gs = parseFen("r2qkb1r/pp2nppp/3p4/2pNN1B1/2BnP3/3P4/PPP2PPP/R2bK2R w KQkq - 1 1");
+        limits.depth = 5;
+        SearchResult result = search.think(gs, limits);
+        REQUIRE(result.score == Search::MATE_SCORE - 3);
+        REQUIRE(moveToString(result.bestMove) == "d5f6");
+    }
+
+    SECTION("Stops with the main thread") {
+        GameState gs = parseFen(middlegameFen);
+        limits.timeMs = 100;
+        SearchResult result = search.think(gs, limits);
+        REQUIRE(result.timeMs < 1000);
+        std::vector<Move> moves = gs.generateMoves();
+        REQUIRE(std::find(moves.begin(), moves.end(), result.bestMove) != moves.end());
+
+        // The search can go again, and back to one thread
+        search.setThreads(1);
+        limits.timeMs = 0;
+        limits.depth = 3;
+        result = search.think(gs, limits);
+        REQUIRE(result.depth == 3);
+    }
+}
+
+TEST_CASE("Test Game::bestMove") {
+    Game g{};
+    SearchLimits limits;
+    limits.depth = 3;
+
+    Move m = g.bestMove(limits);
+    MoveView moves = g.getMoves();
+    REQUIRE(std::find(moves.begin(), moves.end(), m) != moves.end());
+
+    // Fool's mate: the engine should find the mate
+    g.tryMove(53, 45); // f3
+    g.tryMove(12, 28); // e5
+    g.tryMove(54, 38); // g4
+    m = g.bestMove(limits);
+    REQUIRE(g.makeMove(m) == BLACK_WINS);
+}
+
+TEST_CASE("Test Game::searchStep") {
+    Game g{};
+    SearchLimits limits;
+    limits.depth = 3;
+
+    g.tryMove(53, 45); // f3
+    g.tryMove(12, 28); // e5
+    g.tryMove(54, 38); // g4
+
+    SearchResult progress;
+    g.startSearch(limits);
+    while (g.searchStep(1000, progress)) {
+    }
+    REQUIRE(progress.depth == 3);
+    REQUIRE(g.makeMove(progress.bestMove) == BLACK_WINS);
+}
@@ -0,0 +1,110 @@
+#include <thread>
+#include <vector>
+#include "catch.hpp"
+
+#include "../src/TranspositionTable.h"
+
+TEST_CASE("Test TranspositionTable") {
+    TranspositionTable tt{1};
+    TranspositionTable::Hit hit{};
+
+    SECTION("Sizes are a power of two number of cache line buckets") {
+        REQUIRE(tt.sizeInBytes() == 1024 * 1024);
+        tt.resize(3);
+        REQUIRE(tt.sizeInBytes() == 2 * 1024 * 1024);
+        tt.resize(0);
+        REQUIRE(tt.sizeInBytes() == 64);
+    }
+
+    SECTION("Stored entries can be probed") {
+        Move m{52, 36, FORCED_MARCH};
+        REQUIRE(!tt.probe(12345, hit));
+
+        tt.store(12345, 7, TranspositionTable::LOWER, -321, m);
+        REQUIRE(tt.probe(12345, hit));
+        REQUIRE(hit.move == m);
+        REQUIRE(hit.score == -321);
+        REQUIRE(hit.depth == 7);
+        REQUIRE(hit.bound == TranspositionTable::LOWER);
+
+        // Keys that share a bucket don't hit each other
+        REQUIRE(!tt.probe(12345 + (1ull << 40u), hit));
+
+        // Storing again without a move keeps the old one
+        tt.store(12345, 8, TranspositionTable::UPPER, 5, Move{});
+        REQUIRE(tt.probe(12345, hit));
+        REQUIRE(hit.move == m);
+        REQUIRE(hit.depth == 8);
+    }
+
+    SECTION("Deep entries from the current search are kept") {
+        // Everything here lands in bucket 0. Fill it, then store one more
+        const uint64_t stride = tt.sizeInBytes() / 64;
+        for (uint64_t i = 0; i < 4; i++) {
+            tt.store(i * stride, i == 2 ? 1 : 10, TranspositionTable::EXACT, 0, Move{});
+        }
+        tt.store(4 * stride, 5, TranspositionTable::EXACT, 0, Move{});
+
+        REQUIRE(!tt.probe(2 * stride, hit)); // The shallowest was replaced
+        REQUIRE(tt.probe(4 * stride, hit));
+        REQUIRE(tt.stats().overwrites == 1);
+
+        // After a new search starts, even a shallow entry replaces the least valuable old one
+        tt.newSearch();
+        tt.store(5 * stride, 1, TranspositionTable::EXACT, 0, Move{});
+        REQUIRE(tt.probe(5 * stride, hit));
+        REQUIRE(!tt.probe(4 * stride, hit));
+    }
+
+    SECTION("Statistics") {
+        tt.store(1, 1, TranspositionTable::EXACT, 0, Move{});
+        tt.probe(1, hit);
+        tt.probe(2, hit);
+        REQUIRE(tt.stats().probes == 2);
+        REQUIRE(tt.stats().hits == 1);
+        REQUIRE(tt.stats().hitRate() == Approx(0.5));
+
+        // 4 entries in each of the 1MB table's 16384 buckets
+        for (uint64_t key = 0; key < 16384 * 4; key++) {
+            tt.store(key, 1, TranspositionTable::EXACT, 0, Move{});
+        }
+        REQUIRE(tt.fillPermille() == 1000);
+
+        tt.newSearch();
+        REQUIRE(tt.fillPermille() == 0);
+
+        tt.clear();
+        REQUIRE(tt.stats().stores == 0);
+        REQUIRE(!tt.probe(1, hit));
+    }
+
+    SECTION("Threads can share the table") {
+        // Every thread stores entries whose data is derived from the key, into a table small enough that they
+        // keep overwriting each other's. Any hit must have data matching its key
+        tt.resize(0);
+        std::vector<std::thread> threads;
+        std::vector<int> mismatches(4, 0);
+        for (int t = 0; t < 4; t++) {
+            threads.emplace_back([&tt, &mismatches, t]() {
+                TranspositionTable::Hit found{};
+                for (uint64_t i = 0; i < 100000; i++) {
+                    uint64_t key = (i * 4 + t) * 0x9e3779b97f4a7c15ull;
+                    tt.store(key, (int) (key >> 59u), TranspositionTable::EXACT, (int16_t) (key >> 40u), Move{});
+                    uint64_t other = ((i ^ 1u) * 4 + (t ^ 1)) * 0x9e3779b97f4a7c15ull;
+                    if (tt.probe(other, found) &&
+                        (found.depth != (int) (other >> 59u) || found.score != (int16_t) (other >> 40u))) {
+                        mismatches[t]++;
+                    }
+                }
+            });
+        }
+        for (std::thread& thread : threads) {
+            thread.join();
+        }
+
+        for (int count : mismatches) {
+            REQUIRE(count == 0);
+        }
+        REQUIRE(tt.stats().stores == 400000);
+    }
+}
@@ -0,0 +1,84 @@
+#include "catch.hpp"
+
+#include "../src/Game.h"
+#include "../src/GameState.h"
+#include "../src/Perft.h"
+#include "treewalk.h"
+
+using namespace CA3;
+
+// Checks the incrementally updated key against one built from scratch
+void requireKeysMatch(GameState& gs) {
+    REQUIRE(gs.getKey() == gs.computeKey());
+}
+
+TEST_CASE("Test Zobrist keys") {
+    SECTION("makeMove keeps the key up to date") {
+        GameState gs = parseFen(promotionFen);
+        forEachNode(gs, 3, requireKeysMatch);
+
+        gs = parseFen(kiwipeteFen);
+        forEachNode(gs, 2, requireKeysMatch);
+    }
+
+    SECTION("Transpositions have equal keys") {
+        GameState a, b;
+        a.makeMove({62, 45, MOVE}); // Nf3
+        a.makeMove({6, 21, MOVE}); // Nf6
+        a.makeMove({57, 42, MOVE}); // Nc3
+        b.makeMove({57, 42, MOVE}); // Nc3
+        b.makeMove({6, 21, MOVE}); // Nf6
+        b.makeMove({62, 45, MOVE}); // Nf3
+        REQUIRE(a.getKey() == b.getKey());
+
+        // Moving the knights out and back restores the start position
+        GameState start, gs;
+        gs.makeMove({62, 45, MOVE}); // Nf3
+        gs.makeMove({6, 21, MOVE}); // Nf6
+        REQUIRE(gs.getKey() != start.getKey());
+        gs.makeMove({45, 62, MOVE}); // Ng1
+        REQUIRE(gs.getKey() != start.getKey()); // Black's knight is still out, and black is to move
+        gs.makeMove({21, 6, MOVE}); // Ng8
+        REQUIRE(gs.getKey() == start.getKey());
+    }
+
+    SECTION("Side to move, castling and en passant change the key") {
+        GameState gs = parseFen("rnbqkbnr/pppppppp/8/8/4P3/8/PPPP1PPP/RNBQKBNR b KQkq e3 0 1");
+        GameState noEnPassant = parseFen("rnbqkbnr/pppppppp/8/8/4P3/8/PPPP1PPP/RNBQKBNR b KQkq - 0 1");
+        GameState noCastle = parseFen("rnbqkbnr/pppppppp/8/8/4P3/8/PPPP1PPP/RNBQKBNR b Kkq e3 0 1");
+        GameState whiteToAct = parseFen("rnbqkbnr/pppppppp/8/8/4P3/8/PPPP1PPP/RNBQKBNR w KQkq e3 0 1");
+
+        REQUIRE(gs.getKey() != noEnPassant.getKey());
+        REQUIRE(gs.getKey() != noCastle.getKey());
+        REQUIRE(gs.getKey() != whiteToAct.getKey());
+
+        // The setters keep the key in sync too
+        noEnPassant.setEnPassantSquare(44);
+        noCastle.setWhiteRookWestLocation(56);
+        whiteToAct.setToAct(BLACK);
+        REQUIRE(noEnPassant.getKey() == gs.getKey());
+        REQUIRE(noCastle.getKey() == gs.getKey());
+        REQUIRE(whiteToAct.getKey() == gs.getKey());
+    }
+
+    SECTION("Game::setBoard sets the key") {
+        Game g{};
+        uint64_t start = g.getKey();
+        REQUIRE(start == GameState{}.getKey());
+
+        g.setBoard("rnbqkbnr"
+                   "pppppppp"
+                   "........"
+                   "........"
+                   "....P..."
+                   "........"
+                   "PPPP.PPP"
+                   "RNBQKBNR");
+        REQUIRE(g.getKey() != start);
+
+        GameState gs;
+        gs.makeMove({52, 36, MOVE}); // e4 as a single move, so there's no en passant square
+        gs.setToAct(WHITE);
+        REQUIRE(g.getKey() == gs.getKey());
+    }
+}
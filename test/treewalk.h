@@ -0,0 +1,31 @@
+#ifndef CHESSAMATEUR3_TREEWALK_H
+#define CHESSAMATEUR3_TREEWALK_H
+
+#include <string>
+#include "../src/GameState.h"
+
+// Positions from https://www.chessprogramming.org/Perft_Results
+const std::string startFen = "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1";
+const std::string kiwipeteFen = "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1";
+const std::string endgameFen = "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1";
+// Castling both ways, en passant, captures of castling rooks and promotions all appear within 3 plies
+const std::string promotionFen = "r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1";
+const std::string buggyFen = "rnbq1k1r/pp1Pbppp/2p5/8/2B5/8/PPP1NnPP/RNBQK2R w KQ - 1 8";
+const std::string middlegameFen = "r4rk1/1pp1qppp/p1np1n2/2b1p1B1/2B1P1b1/P1NP1N2/1PP1QPPP/R4RK1 w - - 0 10";
+
+// Calls visit(gs) at gs and after every line of legal moves up to depth plies from it. gs is as it was afterwards
+template<typename Visit>
+void forEachNode(GameState& gs, int depth, Visit&& visit) {
+    visit(gs);
+    if (depth == 0) {
+        return;
+    }
+
+    for (Move m : gs.generateMoves()) {
+        gs.makeMove(m);
+        forEachNode(gs, depth - 1, visit);
+        gs.unmakeMove();
+    }
+}
+
+#endif //CHESSAMATEUR3_TREEWALK_H
@@ -3,6 +3,7 @@
 #include <string>
 #include "src/Game.h"
 #include "src/Error.h"
+#include "src/Search.h"
 
 emscripten::val errorHandler = emscripten::val::global("console.log");
 emscripten::val logHandler = emscripten::val::undefined();
@@ -16,24 +17,29 @@ void newGame() {
     g.newGame();
 }
 
+// Calls the handler for a game-ending result. Returns false if the move isn't complete yet (promotion)
+bool handleResult(MoveResult result) {
+    switch (result) {
+        case WHITE_WINS:
+        case BLACK_WINS:
+            victoryHandler();
+            break;
+        case STALEMATE:
+            stalemateHandler();
+            break;
+        case CHOOSE_PROMOTION:
+            promotionHandler();
+            return false;
+        default: // Nothing needs to be done
+            break;
+    }
+    return true;
+}
+
 bool tryMove(int from, int to) {
-    bool logMove = true;
+    bool logMove;
     try {
-        MoveResult result = g.tryMove(from, to);
-        switch (result) {
-            case WHITE_WINS:
-            case BLACK_WINS:
-                victoryHandler();
-                break;
-            case STALEMATE:
-                stalemateHandler();
-                break;
-            case CHOOSE_PROMOTION:
-                promotionHandler();
-                logMove = false;
-            default: // Nothing needs to be done
-                break;
-        }
+        logMove = handleResult(g.tryMove(from, to));
     } catch (Error& e) {
         errorHandler(e.what());
         return false;
@@ -46,6 +52,73 @@ bool tryMove(int from, int to) {
     return true;
 }
 
+// Makes a move chosen by the engine, packed as by Move::pack. Returns false if it isn't legal here,
+// eg if the game moved on while the engine was thinking
+bool playMove(int packed) {
+    Move m = Move::unpack((uint16_t) packed);
+    if (!g.isLegal(m)) {
+        return false;
+    }
+
+    handleResult(g.makeMove(m));
+    logHandler(g.lastMoveString());
+    return true;
+}
+
+// Lets the engine think for up to timeMs and make its move for the active player.
+// Returns the move's from square + 64 * its to square, or -1 if there was no move to make.
+// This blocks the page while it thinks; engine.js runs the search in a worker instead
+int computerMove(int timeMs) {
+    SearchLimits limits;
+    limits.timeMs = timeMs;
+
+    Move m = g.bestMove(limits);
+    if (m == Move{} || !playMove(m.pack())) {
+        return -1;
+    }
+
+    return m.from + 64 * m.to;
+}
+
+// Starts a search of the current position to be run a slice at a time with searchStep, for pages that can't use
+// the engine worker. Limits of 0 mean no limit
+void startSearch(int depth, double timeMs, double nodes) {
+    SearchLimits limits;
+    if (depth > 0) {
+        limits.depth = depth;
+    }
+    limits.timeMs = (int64_t) timeMs;
+    limits.nodes = (uint64_t) nodes;
+    g.startSearch(limits);
+}
+
+// Searches for about budgetUs microseconds and reports progress as {done, depth, score, nodes, timeMs, move},
+// with the best move so far packed as by Move::pack (-1 if there is none). The move isn't made
+emscripten::val searchStep(int budgetUs) {
+    SearchResult progress;
+    bool searching = g.searchStep(budgetUs, progress);
+
+    emscripten::val report = emscripten::val::object();
+    report.set("done", !searching);
+    report.set("depth", progress.depth);
+    report.set("score", progress.score);
+    report.set("nodes", (double) progress.nodes);
+    report.set("timeMs", (double) progress.timeMs);
+    report.set("move", progress.bestMove == Move{} ? -1 : (int) progress.bestMove.pack());
+    return report;
+}
+
+// The moves played so far, packed as by Move::pack, to send to the engine worker
+emscripten::val getMoveHistory() {
+    std::vector<uint16_t> packed;
+    for (Move m : g.getMoveHistory()) {
+        packed.push_back(m.pack());
+    }
+
+    // typed_memory_view points into the wasm heap, so copy it into an array of its own
+    return emscripten::val::global("Uint16Array").new_(emscripten::typed_memory_view(packed.size(), packed.data()));
+}
+
 std::string getPieces() {
     return g.getBoard();
 }
@@ -90,6 +163,11 @@ EMSCRIPTEN_BINDINGS(my_module) {
         emscripten::function("tryMove", &tryMove);
         emscripten::function("promote", &promoteTo);
         emscripten::function("whiteToMove", &whiteToMove);
+        emscripten::function("computerMove", &computerMove);
+        emscripten::function("playMove", &playMove);
+        emscripten::function("getMoveHistory", &getMoveHistory);
+        emscripten::function("startSearch", &startSearch);
+        emscripten::function("searchStep", &searchStep);
 
         emscripten::function("registerErrorHandler", &registerErrorHandler);
         emscripten::function("registerLogHandler", &registerLogHandler);
@@ -0,0 +1,94 @@
+#include <emscripten/bind.h>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "src/Error.h"
+#include "src/GameState.h"
+#include "src/Nnue.h"
+#include "src/Search.h"
+#include "src/TranspositionTable.h"
+
+// Bindings for the engine worker (engine-worker.js). The worker keeps its own copy of the game, set from the
+// list of moves played, and searches it without touching the page's module
+
+constexpr size_t HASH_MEGABYTES = 16;
+
+TranspositionTable tt{HASH_MEGABYTES};
+Search search{tt};
+GameState gs{};
+std::vector<uint64_t> history; // Keys of the positions before each move, for repetition detection
+std::unique_ptr<Nnue> network;
+
+emscripten::val infoHandler = emscripten::val::undefined();
+
+void newGame() {
+    tt.clear();
+    search.clear();
+    gs = GameState{};
+    history.clear();
+}
+
+// Replays the game from the start. moves holds each move packed as by Move::pack
+void setPosition(emscripten::val moves) {
+    gs = GameState{};
+    history.clear();
+
+    for (int packed : emscripten::vecFromJSArray<int>(moves)) {
+        history.push_back(gs.getKey());
+        gs.makeMove(Move::unpack((uint16_t) packed));
+    }
+}
+
+// Searches the position within the limits (0 for none) and returns the best move packed, or -1 if there is none.
+// The info handler hears about each completed iteration
+int think(int depth, double timeMs, double nodes) {
+    SearchLimits limits;
+    if (depth > 0) {
+        limits.depth = depth;
+    }
+    limits.timeMs = (int64_t) timeMs;
+    limits.nodes = (uint64_t) nodes;
+
+    search.onIteration = [](const SearchResult& result) {
+        if (infoHandler.isUndefined()) {
+            return;
+        }
+        infoHandler(result.depth, result.score, (double) result.nodes, (double) result.timeMs,
+                    (int) result.bestMove.pack());
+    };
+
+    SearchResult result = search.think(gs, limits, history);
+    return result.bestMove == Move{} ? -1 : result.bestMove.pack();
+}
+
+// Evaluates with the network in bytes (a file saved by Nnue::save, fetched by the page) from the next search on.
+// If bytes don't hold a network, goes back to the piece-square tables and returns false
+bool loadNetwork(std::string bytes) {
+    search.setNetwork(nullptr);
+    network.reset();
+
+    std::istringstream in{bytes};
+    std::unique_ptr<Nnue> loaded = std::make_unique<Nnue>();
+    try {
+        loaded->load(in);
+    } catch (Error& e) {
+        return false;
+    }
+
+    network = std::move(loaded);
+    search.setNetwork(network.get());
+    return true;
+}
+
+void registerInfoHandler(emscripten::val cb) {
+    infoHandler = cb;
+}
+
+EMSCRIPTEN_BINDINGS(engine_worker) {
+        emscripten::function("newGame", &newGame);
+        emscripten::function("setPosition", &setPosition);
+        emscripten::function("think", &think);
+        emscripten::function("loadNetwork", &loadNetwork);
+        emscripten::function("registerInfoHandler", &registerInfoHandler);
+}